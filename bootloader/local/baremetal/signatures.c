@@ -20,8 +20,10 @@
 /* === Includes ============================================================ */
 
 #include <stdint.h>
+#include <string.h>
 
 #include <sha2.h>
+#include <bignum.h>
 #include <ecdsa.h>
 #include <secp256k1.h>
 #include <memory.h>
@@ -79,8 +81,38 @@ static const uint8_t pubkey[PUBKEYS][PUBKEY_LENGTH] =
     }
 };
 
+/*
+ * Precomputed odd multiples of the public keys above for fixed-base
+ * multiplication, generated by bootloader/mkpubkeytable.py
+ */
+static const ecdsa_pubkey_table pubkey_table[PUBKEYS] =
+{
+#include "pubkeys.table"
+};
+
 /* === Functions =========================================================== */
 
+#if !defined(DEBUG_ON) || DEBUG_LINK
+/*
+ * pubkey_table_ok - checks that the precomputed table of a public key
+ * belongs to that key
+ *
+ * INPUT
+ *     index - index of the public key
+ * OUTPUT
+ *     returns 1 if the table matches the public key, otherwise 0
+ */
+static int pubkey_table_ok(uint8_t index)
+{
+    uint8_t coords[PUBKEY_LENGTH - 1];
+
+    bn_write_be(&pubkey_table[index].p[0][0].x, coords);
+    bn_write_be(&pubkey_table[index].p[0][0].y, coords + 32);
+
+    return memcmp(coords, pubkey[index] + 1, sizeof(coords)) == 0;
+}
+#endif
+
 /*
  * signatures_ok - checks firmware signatures
  *
@@ -95,6 +127,13 @@ int signatures_ok(void)
 #if !defined(DEBUG_ON) || DEBUG_LINK
     uint32_t codelen = *((uint32_t *)FLASH_META_CODELEN);
     uint8_t sigindex1, sigindex2, sigindex3, firmware_fingerprint[32];
+    const ecdsa_pubkey_table *sig_pubkeys[SIGNATURES];
+    const uint8_t *sigs[SIGNATURES] =
+    {
+        (uint8_t *)FLASH_META_SIG1,
+        (uint8_t *)FLASH_META_SIG2,
+        (uint8_t *)FLASH_META_SIG3
+    };
 
     sigindex1 = *((uint8_t *)FLASH_META_SIGINDEX1);
     sigindex2 = *((uint8_t *)FLASH_META_SIGINDEX2);
@@ -114,20 +153,20 @@ int signatures_ok(void)
 
     sha256_Raw((uint8_t *)FLASH_APP_START, codelen, firmware_fingerprint);
 
-    if(ecdsa_verify_digest(&secp256k1, pubkey[sigindex1 - 1], (uint8_t *)FLASH_META_SIG1,
-                           firmware_fingerprint) != 0)   /* Failure */
-    {
-        return 0;
-    }
+    /* Tables must not be stale */
+    if(!pubkey_table_ok(sigindex1 - 1)) { return 0; }
 
-    if(ecdsa_verify_digest(&secp256k1, pubkey[sigindex2 - 1], (uint8_t *)FLASH_META_SIG2,
-                           firmware_fingerprint) != 0)   /* Failure */
-    {
-        return 0;
-    }
+    if(!pubkey_table_ok(sigindex2 - 1)) { return 0; }
+
+    if(!pubkey_table_ok(sigindex3 - 1)) { return 0; }
+
+    sig_pubkeys[0] = &pubkey_table[sigindex1 - 1];
+    sig_pubkeys[1] = &pubkey_table[sigindex2 - 1];
+    sig_pubkeys[2] = &pubkey_table[sigindex3 - 1];
 
-    if(ecdsa_verify_digest(&secp256k1, pubkey[sigindex3 - 1], (uint8_t *)FLASH_META_SIG3,
-                           firmware_fingerprint) != 0)   /* Failure */
+    /* Verify all signatures at once, using the precomputed key tables */
+    if(ecdsa_verify_digest_batch_table(&secp256k1, sig_pubkeys, sigs, firmware_fingerprint,
+                                       SIGNATURES) != 0)   /* Failure */
     {
         return 0;
     }
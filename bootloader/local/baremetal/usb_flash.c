@@ -46,6 +46,8 @@ static Allocation storage_location = FLASH_INVALID;
 static FirmwareUploadState upload_state = UPLOAD_NOT_STARTED;
 static uint8_t storage_sav[STOR_FLASH_SECT_LEN];
 static uint8_t firmware_hash[SHA256_DIGEST_LENGTH];
+static SHA256_CTX firmware_ctx;
+static uint32_t flash_offset;
 extern bool reset_msg_stack;
 
 static const MessagesMap_t MessagesMap[] =
@@ -84,6 +86,11 @@ static const MessagesMap_t MessagesMap[] =
 /*
  * check_firmware_hash - Checks flashed firmware's hash
  *
+ * The image is hashed while it is uploaded and every chunk is read back
+ * after programming, so when the upload covers exactly the meta descriptor
+ * and the code length it declares, the streamed hash is the hash of the
+ * flash contents and the flash does not need to be read again.
+ *
  * INPUT
  *     none
  *
@@ -93,8 +100,16 @@ static const MessagesMap_t MessagesMap[] =
 static bool check_firmware_hash(void)
 {
     uint8_t flashed_firmware_hash[SHA256_DIGEST_LENGTH];
+    uint32_t codelen = *((uint32_t *)FLASH_META_CODELEN);
 
-    memory_firmware_hash(flashed_firmware_hash);
+    if(codelen <= FLASH_APP_LEN && flash_offset == FLASH_META_DESC_LEN + codelen)
+    {
+        sha256_Final(flashed_firmware_hash, &firmware_ctx);
+    }
+    else
+    {
+        memory_firmware_hash(flashed_firmware_hash);
+    }
 
     return(memcmp(firmware_hash, flashed_firmware_hash, SHA256_DIGEST_LENGTH) == 0);
 }
@@ -473,8 +488,6 @@ void handler_erase(FirmwareErase *msg)
  */
 void raw_handler_upload(uint8_t *msg, uint32_t msg_size, uint32_t frame_length)
 {
-    static uint32_t flash_offset;
-
     /* Check file size is within allocated space */
     if(frame_length < (FLASH_APP_LEN + FLASH_META_DESC_LEN))
     {
@@ -510,6 +523,11 @@ void raw_handler_upload(uint8_t *msg, uint32_t msg_size, uint32_t frame_length)
                         msg_size -= META_MAGIC_SIZE;
                         msg = (uint8_t *)(msg + META_MAGIC_SIZE);
                         flash_offset = META_MAGIC_SIZE;
+
+                        /* The magic is hashed here, but only written once the hash checks out */
+                        sha256_Init(&firmware_ctx);
+                        sha256_Update(&firmware_ctx, (const uint8_t *)META_MAGIC_STR, META_MAGIC_SIZE);
+
                         /* Unlock the flash for writing */
                         flash_unlock();
                     }
@@ -524,8 +542,12 @@ void raw_handler_upload(uint8_t *msg, uint32_t msg_size, uint32_t frame_length)
 
                 }
 
-                /* Begin writing to flash */
-                if(!flash_write(FLASH_APP, flash_offset, msg_size, msg))
+                /* Hash the chunk as it arrives instead of re-reading the flash afterwards */
+                sha256_Update(&firmware_ctx, msg, msg_size);
+
+                /* Begin writing to flash, and read it back while the chunk is still in RAM */
+                if(!flash_write(FLASH_APP, flash_offset, msg_size, msg) ||
+                        memcmp((const void *)(flash_write_helper(FLASH_APP) + flash_offset), msg, msg_size) != 0)
                 {
                     /* Error: flash write error */
                     flash_lock();
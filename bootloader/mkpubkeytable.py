@@ -0,0 +1,102 @@
+#!/usr/bin/env python
+#
+# Generates public/pubkeys.table from the firmware signing keys in
+# local/baremetal/signatures.c.
+#
+# For every public key P the table holds the odd multiples
+#   (2*i+1) * 2^(64*t) * P      for t = 0..3, i = 0..7
+# in the bignum256 format of the crypto library (9 limbs of 30 bits),
+# see ecdsa_pubkey_table in ecdsa.h.
+#
+# Run this script again whenever the keys in signatures.c change:
+#   python bootloader/mkpubkeytable.py
+#
+
+from __future__ import print_function
+
+import os
+import re
+import sys
+
+# secp256k1 domain parameters
+P = 2**256 - 2**32 - 977
+A = 0
+B = 7
+
+def inverse(x):
+    return pow(x, P - 2, P)
+
+def point_add(p1, p2):
+    if p1 is None:
+        return p2
+    if p2 is None:
+        return p1
+    x1, y1 = p1
+    x2, y2 = p2
+    if x1 == x2:
+        if (y1 + y2) % P == 0:
+            return None
+        lam = (3 * x1 * x1 + A) * inverse(2 * y1) % P
+    else:
+        lam = (y2 - y1) * inverse(x2 - x1) % P
+    x3 = (lam * lam - x1 - x2) % P
+    y3 = (lam * (x1 - x3) - y1) % P
+    return (x3, y3)
+
+def point_double(p):
+    return point_add(p, p)
+
+def bignum(x):
+    limbs = []
+    for i in range(8):
+        limbs.append('0x%08x' % (x & 0x3fffffff))
+        x >>= 30
+    limbs.append('0x%04x' % x)
+    return '{{' + ', '.join(limbs) + '}}'
+
+def read_pubkeys(path):
+    with open(path) as f:
+        source = f.read()
+    match = re.search(r'pubkey\[PUBKEYS\]\[PUBKEY_LENGTH\]\s*=\s*\{(.*?)\n\};', source, re.S)
+    if not match:
+        sys.exit('pubkey array not found in ' + path)
+    keys = []
+    for block in re.findall(r'\{([^{}]*)\}', match.group(1)):
+        data = [int(b, 16) for b in re.findall(r'0x([0-9a-fA-F]{2})', block)]
+        if len(data) != 65 or data[0] != 0x04:
+            sys.exit('expected uncompressed public keys')
+        x = int(''.join('%02x' % b for b in data[1:33]), 16)
+        y = int(''.join('%02x' % b for b in data[33:65]), 16)
+        if (y * y - x * x * x - A * x - B) % P != 0:
+            sys.exit('public key is not on the curve')
+        keys.append((x, y))
+    return keys
+
+def main():
+    root = os.path.dirname(os.path.abspath(__file__))
+    keys = read_pubkeys(os.path.join(root, 'local', 'baremetal', 'signatures.c'))
+
+    out = []
+    for n, key in enumerate(keys):
+        out.append('\t/* Public key %d */' % (n + 1))
+        out.append('\t{{')
+        base = key
+        for t in range(4):
+            out.append('\t\t{')
+            twice = point_double(base)
+            point = base
+            for i in range(8):
+                out.append('\t\t\t/* %2d*2^%d*P: */' % (2 * i + 1, 64 * t))
+                out.append('\t\t\t{%s,' % bignum(point[0]))
+                out.append('\t\t\t %s}%s' % (bignum(point[1]), ',' if i < 7 else ''))
+                point = point_add(point, twice)
+            out.append('\t\t}%s' % (',' if t < 3 else ''))
+            for _ in range(64):
+                base = point_double(base)
+        out.append('\t}}%s' % (',' if n < len(keys) - 1 else ''))
+
+    with open(os.path.join(root, 'public', 'pubkeys.table'), 'w') as f:
+        f.write('\n'.join(out) + '\n')
+
+if __name__ == '__main__':
+    main()
@@ -0,0 +1,492 @@
+/**
+ * Copyright (c) 2015 KeepKey LLC
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES
+ * OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+// Table-free AES-256 block functions for the Gladman modes in aes_modes.c.
+//
+// The 16 bytes of a block are kept as eight bit planes: bit i of q[b] is
+// bit b of byte i, so byte 4 * c + r (row r of column c) is at bit
+// position 4 * c + r.  Each round works on all bytes at once with plain
+// logic operations, without any memory access that depends on the data.
+
+#include <string.h>
+
+#include "aesopt.h"
+#include "macros.h"
+
+#if USE_AES_BITSLICE
+
+// S-box circuit by Boyar and Peralta, q[0] is the least significant bit
+static void aes_bs_sbox(uint32_t q[8])
+{
+	uint32_t x0, x1, x2, x3, x4, x5, x6, x7;
+	uint32_t y1, y2, y3, y4, y5, y6, y7, y8, y9;
+	uint32_t y10, y11, y12, y13, y14, y15, y16, y17, y18, y19;
+	uint32_t y20, y21;
+	uint32_t z0, z1, z2, z3, z4, z5, z6, z7, z8, z9;
+	uint32_t z10, z11, z12, z13, z14, z15, z16, z17;
+	uint32_t t0, t1, t2, t3, t4, t5, t6, t7, t8, t9;
+	uint32_t t10, t11, t12, t13, t14, t15, t16, t17, t18, t19;
+	uint32_t t20, t21, t22, t23, t24, t25, t26, t27, t28, t29;
+	uint32_t t30, t31, t32, t33, t34, t35, t36, t37, t38, t39;
+	uint32_t t40, t41, t42, t43, t44, t45, t46, t47, t48, t49;
+	uint32_t t50, t51, t52, t53, t54, t55, t56, t57, t58, t59;
+	uint32_t t60, t61, t62, t63, t64, t65, t66, t67;
+	uint32_t s0, s1, s2, s3, s4, s5, s6, s7;
+
+	x0 = q[7];
+	x1 = q[6];
+	x2 = q[5];
+	x3 = q[4];
+	x4 = q[3];
+	x5 = q[2];
+	x6 = q[1];
+	x7 = q[0];
+
+	// top linear transformation
+	y14 = x3 ^ x5;
+	y13 = x0 ^ x6;
+	y9 = x0 ^ x3;
+	y8 = x0 ^ x5;
+	t0 = x1 ^ x2;
+	y1 = t0 ^ x7;
+	y4 = y1 ^ x3;
+	y12 = y13 ^ y14;
+	y2 = y1 ^ x0;
+	y5 = y1 ^ x6;
+	y3 = y5 ^ y8;
+	t1 = x4 ^ y12;
+	y15 = t1 ^ x5;
+	y20 = t1 ^ x1;
+	y6 = y15 ^ x7;
+	y10 = y15 ^ t0;
+	y11 = y20 ^ y9;
+	y7 = x7 ^ y11;
+	y17 = y10 ^ y11;
+	y19 = y10 ^ y8;
+	y16 = t0 ^ y11;
+	y21 = y13 ^ y16;
+	y18 = x0 ^ y16;
+
+	// inversion in GF(2^4)^2
+	t2 = y12 & y15;
+	t3 = y3 & y6;
+	t4 = t3 ^ t2;
+	t5 = y4 & x7;
+	t6 = t5 ^ t2;
+	t7 = y13 & y16;
+	t8 = y5 & y1;
+	t9 = t8 ^ t7;
+	t10 = y2 & y7;
+	t11 = t10 ^ t7;
+	t12 = y9 & y11;
+	t13 = y14 & y17;
+	t14 = t13 ^ t12;
+	t15 = y8 & y10;
+	t16 = t15 ^ t12;
+	t17 = t4 ^ t14;
+	t18 = t6 ^ t16;
+	t19 = t9 ^ t14;
+	t20 = t11 ^ t16;
+	t21 = t17 ^ y20;
+	t22 = t18 ^ y19;
+	t23 = t19 ^ y21;
+	t24 = t20 ^ y18;
+
+	t25 = t21 ^ t22;
+	t26 = t21 & t23;
+	t27 = t24 ^ t26;
+	t28 = t25 & t27;
+	t29 = t28 ^ t22;
+	t30 = t23 ^ t24;
+	t31 = t22 ^ t26;
+	t32 = t31 & t30;
+	t33 = t32 ^ t24;
+	t34 = t23 ^ t33;
+	t35 = t27 ^ t33;
+	t36 = t24 & t35;
+	t37 = t36 ^ t34;
+	t38 = t27 ^ t36;
+	t39 = t29 & t38;
+	t40 = t25 ^ t39;
+
+	t41 = t40 ^ t37;
+	t42 = t29 ^ t33;
+	t43 = t29 ^ t40;
+	t44 = t33 ^ t37;
+	t45 = t42 ^ t41;
+	z0 = t44 & y15;
+	z1 = t37 & y6;
+	z2 = t33 & x7;
+	z3 = t43 & y16;
+	z4 = t40 & y1;
+	z5 = t29 & y7;
+	z6 = t42 & y11;
+	z7 = t45 & y17;
+	z8 = t41 & y10;
+	z9 = t44 & y12;
+	z10 = t37 & y3;
+	z11 = t33 & y4;
+	z12 = t43 & y13;
+	z13 = t40 & y5;
+	z14 = t29 & y2;
+	z15 = t42 & y9;
+	z16 = t45 & y14;
+	z17 = t41 & y8;
+
+	// bottom linear transformation
+	t46 = z15 ^ z16;
+	t47 = z10 ^ z11;
+	t48 = z5 ^ z13;
+	t49 = z9 ^ z10;
+	t50 = z2 ^ z12;
+	t51 = z2 ^ z5;
+	t52 = z7 ^ z8;
+	t53 = z0 ^ z3;
+	t54 = z6 ^ z7;
+	t55 = z16 ^ z17;
+	t56 = z12 ^ t48;
+	t57 = t50 ^ t53;
+	t58 = z4 ^ t46;
+	t59 = z3 ^ t54;
+	t60 = t46 ^ t57;
+	t61 = z14 ^ t57;
+	t62 = t52 ^ t58;
+	t63 = t49 ^ t58;
+	t64 = z4 ^ t59;
+	t65 = t61 ^ t62;
+	t66 = z1 ^ t63;
+	s0 = t59 ^ t63;
+	s6 = t56 ^ ~t62;
+	s7 = t48 ^ ~t60;
+	t67 = t64 ^ t65;
+	s3 = t53 ^ t66;
+	s4 = t51 ^ t66;
+	s5 = t47 ^ t65;
+	s1 = t64 ^ ~s3;
+	s2 = t55 ^ ~t67;
+
+	q[7] = s0;
+	q[6] = s1;
+	q[5] = s2;
+	q[4] = s3;
+	q[3] = s4;
+	q[2] = s5;
+	q[1] = s6;
+	q[0] = s7;
+}
+
+// B(x ^ 0x63), B being the inverse of the affine map of the S-box
+static void aes_bs_inv_affine(uint32_t q[8])
+{
+	uint32_t q0, q1, q2, q3, q4, q5, q6, q7;
+
+	q0 = ~q[0];
+	q1 = ~q[1];
+	q2 = q[2];
+	q3 = q[3];
+	q4 = q[4];
+	q5 = ~q[5];
+	q6 = ~q[6];
+	q7 = q[7];
+	q[7] = q1 ^ q4 ^ q6;
+	q[6] = q0 ^ q3 ^ q5;
+	q[5] = q7 ^ q2 ^ q4;
+	q[4] = q6 ^ q1 ^ q3;
+	q[3] = q5 ^ q0 ^ q2;
+	q[2] = q4 ^ q7 ^ q1;
+	q[1] = q3 ^ q6 ^ q0;
+	q[0] = q2 ^ q5 ^ q7;
+}
+
+// S^-1(x) = B(S(B(x ^ 0x63)) ^ 0x63), as inversion is an involution
+static void aes_bs_inv_sbox(uint32_t q[8])
+{
+	aes_bs_inv_affine(q);
+	aes_bs_sbox(q);
+	aes_bs_inv_affine(q);
+}
+
+// row r of every plane is rotated by 4 * r bit positions
+static void aes_bs_shift_rows(uint32_t q[8])
+{
+	int i;
+	uint32_t x;
+
+	for (i = 0; i < 8; i++) {
+		x = q[i];
+		q[i] = (x & 0x1111)
+			| ((x >> 4) & 0x0222) | ((x << 12) & 0x2000)
+			| ((x >> 8) & 0x0044) | ((x << 8) & 0x4400)
+			| ((x >> 12) & 0x0008) | ((x << 4) & 0x8880);
+	}
+}
+
+static void aes_bs_inv_shift_rows(uint32_t q[8])
+{
+	int i;
+	uint32_t x;
+
+	for (i = 0; i < 8; i++) {
+		x = q[i];
+		q[i] = (x & 0x1111)
+			| ((x << 4) & 0x2220) | ((x >> 12) & 0x0002)
+			| ((x >> 8) & 0x0044) | ((x << 8) & 0x4400)
+			| ((x << 12) & 0x8000) | ((x >> 4) & 0x0888);
+	}
+}
+
+// rotate the rows of every column by one and by two positions
+#define ROT1(x) ((((x) >> 1) & 0x7777) | (((x) << 3) & 0x8888))
+#define ROT2(x) ((((x) >> 2) & 0x3333) | (((x) << 2) & 0xcccc))
+
+// q = {02} * q in GF(2^8)
+static void aes_bs_xtime(uint32_t q[8])
+{
+	uint32_t hi = q[7];
+
+	q[7] = q[6];
+	q[6] = q[5];
+	q[5] = q[4];
+	q[4] = q[3] ^ hi;
+	q[3] = q[2] ^ hi;
+	q[2] = q[1];
+	q[1] = q[0] ^ hi;
+	q[0] = hi;
+}
+
+// a'[r] = {02} * (a[r] ^ a[r+1]) ^ a[r+1] ^ a[r+2] ^ a[r+3]
+static void aes_bs_mix_columns(uint32_t q[8])
+{
+	int i;
+	uint32_t r1[8], t[8];
+
+	for (i = 0; i < 8; i++) {
+		r1[i] = ROT1(q[i]);
+		t[i] = q[i] ^ r1[i];
+	}
+	memcpy(q, t, sizeof(t));
+	aes_bs_xtime(q);
+	for (i = 0; i < 8; i++) {
+		q[i] ^= r1[i] ^ ROT2(t[i]);
+	}
+}
+
+// InvMixColumns is MixColumns after a[r] ^= {04} * (a[r] ^ a[r+2])
+static void aes_bs_inv_mix_columns(uint32_t q[8])
+{
+	int i;
+	uint32_t t[8];
+
+	for (i = 0; i < 8; i++) {
+		t[i] = q[i] ^ ROT2(q[i]);
+	}
+	aes_bs_xtime(t);
+	aes_bs_xtime(t);
+	for (i = 0; i < 8; i++) {
+		q[i] ^= t[i];
+	}
+	aes_bs_mix_columns(q);
+}
+
+// transpose an 8x8 bit matrix held in two words, row k being byte k
+#define SWAPMOVE(a, b, m, n) do { \
+	uint32_t tmp = ((b) ^ ((a) >> (n))) & (m); \
+	(b) ^= tmp; \
+	(a) ^= tmp << (n); \
+} while (0)
+
+static void aes_bs_transpose8(uint32_t *lo, uint32_t *hi)
+{
+	SWAPMOVE(*lo, *lo, 0x00aa00aa, 7);
+	SWAPMOVE(*hi, *hi, 0x00aa00aa, 7);
+	SWAPMOVE(*lo, *lo, 0x0000cccc, 14);
+	SWAPMOVE(*hi, *hi, 0x0000cccc, 14);
+	SWAPMOVE(*lo, *hi, 0x0f0f0f0f, 4);
+}
+
+static void aes_bs_load(const unsigned char *in, uint32_t q[8])
+{
+	int i;
+	uint32_t a0, a1, b0, b1;
+
+	a0 = (uint32_t)in[0] | ((uint32_t)in[1] << 8) | ((uint32_t)in[2] << 16) | ((uint32_t)in[3] << 24);
+	a1 = (uint32_t)in[4] | ((uint32_t)in[5] << 8) | ((uint32_t)in[6] << 16) | ((uint32_t)in[7] << 24);
+	b0 = (uint32_t)in[8] | ((uint32_t)in[9] << 8) | ((uint32_t)in[10] << 16) | ((uint32_t)in[11] << 24);
+	b1 = (uint32_t)in[12] | ((uint32_t)in[13] << 8) | ((uint32_t)in[14] << 16) | ((uint32_t)in[15] << 24);
+	aes_bs_transpose8(&a0, &a1);
+	aes_bs_transpose8(&b0, &b1);
+	for (i = 0; i < 4; i++) {
+		q[i] = ((a0 >> (8 * i)) & 0xff) | (((b0 >> (8 * i)) & 0xff) << 8);
+		q[i + 4] = ((a1 >> (8 * i)) & 0xff) | (((b1 >> (8 * i)) & 0xff) << 8);
+	}
+}
+
+static void aes_bs_store(const uint32_t q[8], unsigned char *out)
+{
+	int i;
+	uint32_t a0 = 0, a1 = 0, b0 = 0, b1 = 0;
+
+	for (i = 0; i < 4; i++) {
+		a0 |= (q[i] & 0xff) << (8 * i);
+		a1 |= (q[i + 4] & 0xff) << (8 * i);
+		b0 |= ((q[i] >> 8) & 0xff) << (8 * i);
+		b1 |= ((q[i + 4] >> 8) & 0xff) << (8 * i);
+	}
+	aes_bs_transpose8(&a0, &a1);
+	aes_bs_transpose8(&b0, &b1);
+	for (i = 0; i < 4; i++) {
+		out[i] = a0 >> (8 * i);
+		out[i + 4] = a1 >> (8 * i);
+		out[i + 8] = b0 >> (8 * i);
+		out[i + 12] = b1 >> (8 * i);
+	}
+}
+
+// round key r is stored as four words, planes 2j and 2j+1 in word j
+static void aes_bs_add_round_key(uint32_t q[8], const uint32_t *ks)
+{
+	int i;
+
+	for (i = 0; i < 4; i++) {
+		q[2 * i] ^= ks[i] & 0xffff;
+		q[2 * i + 1] ^= ks[i] >> 16;
+	}
+}
+
+// the expanded key has 15 round keys of 16 bytes, which fill ks exactly
+static void aes_bs_key256(const unsigned char *key, uint32_t ks[KS_LENGTH])
+{
+	int i, j;
+	uint8_t w[4 * KS_LENGTH], rcon = 1;
+	uint32_t q[8];
+
+	memcpy(w, key, 32);
+	for (i = 8; i < KS_LENGTH; i++) {
+		if (i % 4 == 0) {
+			// SubWord on the four bytes of the previous word
+			memset(q, 0, sizeof(q));
+			for (j = 0; j < 4; j++) {
+				int b;
+				for (b = 0; b < 8; b++) {
+					q[b] |= (uint32_t)((w[4 * (i - 1) + j] >> b) & 1) << j;
+				}
+			}
+			aes_bs_sbox(q);
+			for (j = 0; j < 4; j++) {
+				int b;
+				uint8_t s = 0;
+				for (b = 0; b < 8; b++) {
+					s |= ((q[b] >> j) & 1) << b;
+				}
+				w[4 * i + j] = s;
+			}
+			if (i % 8 == 0) {
+				// RotWord and Rcon
+				uint8_t s = w[4 * i];
+				w[4 * i] = w[4 * i + 1] ^ rcon;
+				w[4 * i + 1] = w[4 * i + 2];
+				w[4 * i + 2] = w[4 * i + 3];
+				w[4 * i + 3] = s;
+				rcon = (rcon << 1) ^ ((rcon >> 7) * 0x1b);
+			}
+		} else {
+			memcpy(&w[4 * i], &w[4 * (i - 1)], 4);
+		}
+		for (j = 0; j < 4; j++) {
+			w[4 * i + j] ^= w[4 * (i - 8) + j];
+		}
+	}
+	for (i = 0; i < 15; i++) {
+		aes_bs_load(&w[16 * i], q);
+		for (j = 0; j < 4; j++) {
+			ks[4 * i + j] = (q[2 * j] & 0xffff) | (q[2 * j + 1] << 16);
+		}
+	}
+	MEMSET_BZERO(w, sizeof(w));
+	MEMSET_BZERO(q, sizeof(q));
+}
+
+AES_RETURN aes_encrypt_key256(const unsigned char *key, aes_encrypt_ctx cx[1])
+{
+	aes_bs_key256(key, cx->ks);
+	cx->inf.l = 0;
+	cx->inf.b[0] = 14 * 16;
+	return EXIT_SUCCESS;
+}
+
+AES_RETURN aes_decrypt_key256(const unsigned char *key, aes_decrypt_ctx cx[1])
+{
+	aes_bs_key256(key, cx->ks);
+	cx->inf.l = 0;
+	cx->inf.b[0] = 14 * 16;
+	return EXIT_SUCCESS;
+}
+
+AES_RETURN aes_encrypt(const unsigned char *in, unsigned char *out, const aes_encrypt_ctx cx[1])
+{
+	int r;
+	uint32_t q[8];
+
+	if (cx->inf.b[0] != 14 * 16) {
+		return EXIT_FAILURE;
+	}
+	aes_bs_load(in, q);
+	aes_bs_add_round_key(q, cx->ks);
+	for (r = 1; r < 14; r++) {
+		aes_bs_sbox(q);
+		aes_bs_shift_rows(q);
+		aes_bs_mix_columns(q);
+		aes_bs_add_round_key(q, cx->ks + 4 * r);
+	}
+	aes_bs_sbox(q);
+	aes_bs_shift_rows(q);
+	aes_bs_add_round_key(q, cx->ks + 4 * 14);
+	aes_bs_store(q, out);
+	MEMSET_BZERO(q, sizeof(q));
+	return EXIT_SUCCESS;
+}
+
+AES_RETURN aes_decrypt(const unsigned char *in, unsigned char *out, const aes_decrypt_ctx cx[1])
+{
+	int r;
+	uint32_t q[8];
+
+	if (cx->inf.b[0] != 14 * 16) {
+		return EXIT_FAILURE;
+	}
+	aes_bs_load(in, q);
+	aes_bs_add_round_key(q, cx->ks + 4 * 14);
+	for (r = 13; r > 0; r--) {
+		aes_bs_inv_shift_rows(q);
+		aes_bs_inv_sbox(q);
+		aes_bs_add_round_key(q, cx->ks + 4 * r);
+		aes_bs_inv_mix_columns(q);
+	}
+	aes_bs_inv_shift_rows(q);
+	aes_bs_inv_sbox(q);
+	aes_bs_add_round_key(q, cx->ks);
+	aes_bs_store(q, out);
+	MEMSET_BZERO(q, sizeof(q));
+	return EXIT_SUCCESS;
+}
+
+#endif
@@ -173,14 +173,16 @@ Issue Date: 20/12/2007
 
 #endif
 
+#if FUNCS_IN_C     /* the bitsliced code in aes_bitslice.c uses no tables */
 #include "aestab.h"
+#endif
 
 #if defined(__cplusplus)
 extern "C"
 {
 #endif
 
-#if defined(FIXED_TABLES)
+#if defined(FIXED_TABLES) || !FUNCS_IN_C
 
 /* implemented in case of wrong call for fixed tables */
 
@@ -47,8 +47,8 @@ bool b58tobin(void *bin, size_t *binszp, const char *b58)
 	size_t outisz = (binsz + 3) / 4;
 	uint32_t outi[outisz];
 	uint64_t t;
-	uint32_t c;
-	size_t i, j;
+	uint32_t c, mul;
+	size_t i, j, k;
 	uint8_t bytesleft = binsz % 4;
 	uint32_t zeromask = bytesleft ? (0xffffffff << (bytesleft * 8)) : 0;
 	unsigned zerocount = 0;
@@ -59,22 +59,32 @@ bool b58tobin(void *bin, size_t *binszp, const char *b58)
 	memset(outi, 0, outisz * sizeof(*outi));
 
 	// Leading zeros, just count
-	for (i = 0; i < b58sz && !b58digits_map[b58u[i]]; ++i)
+	for (i = 0; i < b58sz && !(b58u[i] & 0x80) && !b58digits_map[b58u[i]]; ++i)
 		++zerocount;
 
-	for ( ; i < b58sz; ++i)
+	// Take up to 5 digits at a time (58^5 < 2^32), so the output
+	// number is multiplied once per group instead of once per digit.
+	// The number only grows, so checking for overflow after each
+	// group rejects exactly the same inputs.
+	while (i < b58sz)
 	{
-		if (b58u[i] & 0x80)
-			// High-bit set on invalid digit
-			return false;
-		if (b58digits_map[b58u[i]] == -1)
-			// Invalid base58 digit
-			return false;
-		c = (unsigned)b58digits_map[b58u[i]];
+		c = 0;
+		mul = 1;
+		for (k = 0; k < 5 && i < b58sz; ++k, ++i)
+		{
+			if (b58u[i] & 0x80)
+				// High-bit set on invalid digit
+				return false;
+			if (b58digits_map[b58u[i]] == -1)
+				// Invalid base58 digit
+				return false;
+			c = c * 58 + (unsigned)b58digits_map[b58u[i]];
+			mul *= 58;
+		}
 		for (j = outisz; j--; )
 		{
-			t = ((uint64_t)outi[j]) * 58 + c;
-			c = (t & 0x3f00000000) >> 32;
+			t = ((uint64_t)outi[j]) * mul + c;
+			c = t >> 32;
 			outi[j] = t & 0xffffffff;
 		}
 		if (c)
@@ -126,8 +136,7 @@ int b58check(const void *bin, size_t binsz, const char *base58str)
 	unsigned i;
 	if (binsz < 4)
 		return -4;
-	sha256_Raw(bin, binsz - 4, buf);
-	sha256_Raw(buf, 32, buf);
+	sha256d_Raw(bin, binsz - 4, buf);
 	if (memcmp(&binc[binsz - 4], buf, 4))
 		return -1;
 
@@ -142,44 +151,65 @@ int b58check(const void *bin, size_t binsz, const char *base58str)
 
 static const char b58digits_ordered[] = "123456789ABCDEFGHJKLMNPQRSTUVWXYZabcdefghijkmnopqrstuvwxyz";
 
+// base of the limbs b58enc works in: 4 base58 digits, so that
+// limb * 256 + carry still fits into 32 bits
+#define B58_LIMB_BASE (58 * 58 * 58 * 58)
+
 bool b58enc(char *b58, size_t *b58sz, const void *data, size_t binsz)
 {
 	const uint8_t *bin = data;
-	int carry;
+	uint32_t carry, limb;
 	ssize_t i, j, high, zcount = 0;
-	size_t size;
+	size_t size, limbs, digits;
+	int k;
 
 	while (zcount < (ssize_t)binsz && !bin[zcount])
 		++zcount;
 
 	size = (binsz - zcount) * 138 / 100 + 1;
-	uint8_t buf[size];
-	memset(buf, 0, size);
+	limbs = (size + 3) / 4;
+	uint32_t buf[limbs];
+	memset(buf, 0, limbs * sizeof(*buf));
 
-	for (i = zcount, high = size - 1; i < (ssize_t)binsz; ++i, high = j)
+	for (i = zcount, high = limbs - 1; i < (ssize_t)binsz; ++i, high = j)
 	{
-		for (carry = bin[i], j = size - 1; (j > high) || carry; --j)
+		for (carry = bin[i], j = limbs - 1; (j > high) || carry; --j)
 		{
-			carry += 256 * buf[j];
-			buf[j] = carry % 58;
-			carry /= 58;
+			carry += buf[j] << 8;
+			buf[j] = carry % B58_LIMB_BASE;
+			carry /= B58_LIMB_BASE;
 		}
 	}
 
-	for (j = 0; j < (ssize_t)size && !buf[j]; ++j);
+	// skip leading zero limbs, then leading zero digits of the first limb
+	for (j = 0; j < (ssize_t)limbs && !buf[j]; ++j);
+	digits = 4 * (limbs - j);
+	if (j < (ssize_t)limbs)
+		for (limb = buf[j]; limb < B58_LIMB_BASE / 58; limb *= 58)
+			--digits;
 
-	if (*b58sz <= zcount + size - j)
+	if (*b58sz <= zcount + digits)
 	{
-		*b58sz = zcount + size - j + 1;
+		*b58sz = zcount + digits + 1;
+		MEMSET_BZERO(buf, limbs * sizeof(*buf));
 		return false;
 	}
 
 	if (zcount)
 		memset(b58, '1', zcount);
-	for (i = zcount; j < (ssize_t)size; ++i, ++j)
-		b58[i] = b58digits_ordered[buf[j]];
+	i = zcount + digits;
 	b58[i] = '\0';
 	*b58sz = i + 1;
+	for (j = limbs - 1; i > zcount; --j)
+	{
+		limb = buf[j];
+		for (k = 0; k < 4 && i > zcount; ++k)
+		{
+			b58[--i] = b58digits_ordered[limb % 58];
+			limb /= 58;
+		}
+	}
+	MEMSET_BZERO(buf, limbs * sizeof(*buf));
 
 	return true;
 }
@@ -192,8 +222,7 @@ int base58_encode_check(const uint8_t *data, int datalen, char *str, int strsize
 	uint8_t buf[datalen + 32];
 	uint8_t *hash = buf + datalen;
 	memcpy(buf, data, datalen);
-	sha256_Raw(data, datalen, hash);
-	sha256_Raw(hash, 32, hash);
+	sha256d_Raw(data, datalen, hash);
 	size_t res = strsize;
 	bool success = b58enc(str, &res, buf, datalen + 4);
 	MEMSET_BZERO(buf, sizeof(buf));
@@ -341,6 +341,113 @@ void bn_multiply_reduce(bignum256 *x, uint32_t res[18], const bignum256 *prime)
 	}
 }
 
+#if USE_SECP256K1_REDUCE
+
+// the field prime of secp256k1, p = 2^256 - 2^32 - 977
+static const bignum256 secp256k1_prime = {
+	{0x3ffffc2f, 0x3ffffffb, 0x3fffffff, 0x3fffffff, 0x3fffffff, 0x3fffffff, 0x3fffffff, 0x3fffffff, 0xffff}
+};
+
+// checks whether prime is the field prime of secp256k1.
+// For the other moduli in use (the group orders and the nist256p1
+// prime) this already fails at the lowest limb.
+static int bn_is_secp256k1_prime(const bignum256 *prime)
+{
+	int i;
+	for (i = 0; i < 9; i++) {
+		if (prime->val[i] != secp256k1_prime.val[i]) {
+			return 0;
+		}
+	}
+	return 1;
+}
+
+// auxiliary function for multiplication.
+// reduces x = res modulo the secp256k1 prime p = 2^256 - c with
+// c = 2^32 + 977.  Instead of subtracting multiples of p it folds the
+// part above 2^256 back using 2^256 = c (mod p).  Note that
+// 2^32 = 4 * 2^30, so multiplying by c is a multiplication by 977
+// plus a multiplication by 4 shifted by one limb.
+// assumes    res normalized, res < 2^540
+// guarantees x partly reduced, i.e., x < 2 * prime
+void bn_multiply_reduce_secp256k1(bignum256 *x, uint32_t res[18])
+{
+	int i;
+	uint32_t h[10], t[11];
+	uint64_t temp, hi;
+
+	// h = res >> 256, at most 284 bits
+	for (i = 0; i < 9; i++) {
+		h[i] = ((res[8 + i] >> 16) | (res[9 + i] << 14)) & 0x3FFFFFFF;
+	}
+	h[9] = res[17] >> 16;
+
+	// t = (res mod 2^256) + h * c, at most 317 bits
+	temp = res[0] + 977 * (uint64_t)h[0];
+	t[0] = temp & 0x3FFFFFFF;
+	for (i = 1; i < 10; i++) {
+		temp >>= 30;
+		temp += (i < 8 ? res[i] : i == 8 ? (res[8] & 0xFFFF) : 0)
+			+ 977 * (uint64_t)h[i] + 4 * (uint64_t)h[i - 1];
+		t[i] = temp & 0x3FFFFFFF;
+	}
+	temp >>= 30;
+	temp += 4 * (uint64_t)h[9];
+	t[10] = temp;
+
+	// hi = t >> 256, at most 61 bits
+	hi = (t[8] >> 16) | ((uint64_t)t[9] << 14) | ((uint64_t)t[10] << 44);
+
+	// x = (t mod 2^256) + hi * c  <  2^256 + 2^95  <  2 * prime
+	temp = t[0] + 977 * (hi & 0x3FFFFFFF);
+	x->val[0] = temp & 0x3FFFFFFF;
+	temp >>= 30;
+	temp += t[1] + 977 * ((hi >> 30) & 0x3FFFFFFF) + 4 * (hi & 0x3FFFFFFF);
+	x->val[1] = temp & 0x3FFFFFFF;
+	temp >>= 30;
+	temp += t[2] + 977 * (hi >> 60) + 4 * ((hi >> 30) & 0x3FFFFFFF);
+	x->val[2] = temp & 0x3FFFFFFF;
+	temp >>= 30;
+	temp += t[3] + 4 * (hi >> 60);
+	x->val[3] = temp & 0x3FFFFFFF;
+	for (i = 4; i < 8; i++) {
+		temp >>= 30;
+		temp += t[i];
+		x->val[i] = temp & 0x3FFFFFFF;
+	}
+	temp >>= 30;
+	x->val[8] = (t[8] & 0xFFFF) + temp;
+
+	MEMSET_BZERO(h, sizeof(h));
+	MEMSET_BZERO(t, sizeof(t));
+}
+
+// bn_fast_mod for the secp256k1 prime p = 2^256 - c.
+// computes x - coef * p as (x - coef * 2^256) + coef * c, which gives
+// exactly the same result as the generic version.
+void bn_fast_mod_secp256k1(bignum256 *x)
+{
+	int j;
+	uint32_t coef;
+	uint64_t temp;
+
+	coef = x->val[8] >> 16;
+	temp = x->val[0] + 977 * (uint64_t)coef;
+	x->val[0] = temp & 0x3FFFFFFF;
+	temp >>= 30;
+	temp += x->val[1] + 4 * (uint64_t)coef;
+	x->val[1] = temp & 0x3FFFFFFF;
+	for (j = 2; j < 8; j++) {
+		temp >>= 30;
+		temp += x->val[j];
+		x->val[j] = temp & 0x3FFFFFFF;
+	}
+	temp >>= 30;
+	x->val[8] = (x->val[8] & 0xFFFF) + temp;
+}
+
+#endif
+
 // Compute x := k * x  (mod prime)
 // both inputs must be smaller than 180 * prime.
 // result is partly reduced (0 <= x < 2 * prime)
@@ -349,10 +456,41 @@ void bn_multiply(const bignum256 *k, bignum256 *x, const bignum256 *prime)
 {
 	uint32_t res[18] = {0};
 	bn_multiply_long(k, x, res);
-	bn_multiply_reduce(x, res, prime); 
+#if USE_SECP256K1_REDUCE
+	if (bn_is_secp256k1_prime(prime)) {
+		bn_multiply_reduce_secp256k1(x, res);
+	} else
+#endif
+	bn_multiply_reduce(x, res, prime);
 	MEMSET_BZERO(res, sizeof(res));
 }
 
+// res = round(k * x / 2^shift)
+// k and x must be normalized and the result must fit into 261 bits.
+void bn_multiply_shift(const bignum256 *k, const bignum256 *x, int shift, bignum256 *res)
+{
+	uint32_t prod[18];
+	uint32_t limb, tmp;
+	int i, pos = shift / 30, bits = shift % 30;
+
+	bn_multiply_long(k, x, prod);
+	// round to nearest by adding the highest bit that is shifted out
+	tmp = shift > 0 ? (prod[(shift - 1) / 30] >> ((shift - 1) % 30)) & 1 : 0;
+	for (i = 0; i < 9; i++) {
+		limb = 0;
+		if (pos + i < 18) {
+			limb = prod[pos + i] >> bits;
+		}
+		if (bits != 0 && pos + i + 1 < 18) {
+			limb |= prod[pos + i + 1] << (30 - bits);
+		}
+		tmp += limb & 0x3FFFFFFF;
+		res->val[i] = tmp & 0x3FFFFFFF;
+		tmp >>= 30;
+	}
+	MEMSET_BZERO(prod, sizeof(prod));
+}
+
 // partly reduce x modulo prime
 // input x does not have to be normalized.
 // x can be any number that fits.
@@ -364,6 +502,13 @@ void bn_fast_mod(bignum256 *x, const bignum256 *prime)
 	uint32_t coef;
 	uint64_t temp;
 
+#if USE_SECP256K1_REDUCE
+	if (bn_is_secp256k1_prime(prime)) {
+		bn_fast_mod_secp256k1(x);
+		return;
+	}
+#endif
+
 	coef = x->val[8] >> 16;
 	// substract (coef * prime) from x
 	// note that we unrolled the first iteration
@@ -416,7 +561,215 @@ void bn_sqrt(bignum256 *x, const bignum256 *prime)
 	MEMSET_BZERO(&p, sizeof(p));
 }
 
-#if ! USE_INVERSE_FAST
+#if USE_INVERSE_SAFEGCD
+
+// The constant time inversion below is based on
+//   Daniel J. Bernstein and Bo-Yin Yang, Fast constant-time gcd
+//   computation and modular inversion.
+// and follows the 32-bit implementation in libsecp256k1 (modinv32).
+// Numbers are kept in signed 30-bit limbs, so a bignum256 converts
+// directly.
+
+typedef struct {
+	int32_t v[9];
+} bn_signed30;
+
+typedef struct {
+	int32_t u, v, q, r;
+} bn_trans2x2;
+
+// perform 30 divsteps on the lowest limbs f0, g0 and compute the
+// transition matrix t, scaled by 2^30.  zeta is -(delta + 1/2).
+int32_t bn_divsteps_30(int32_t zeta, uint32_t f0, uint32_t g0, bn_trans2x2 *t)
+{
+	// u, v, q, r are signed numbers in [-2^30, 2^30] stored mod 2^32.
+	uint32_t u = 1, v = 0, q = 0, r = 1;
+	uint32_t c1, c2, f = f0, g = g0, x, y, z;
+	int i;
+
+	for (i = 0; i < 30; i++) {
+		assert((f & 1) == 1);
+		// c1 = (zeta < 0) mask, c2 = (g odd) mask
+		c1 = (uint32_t)(zeta >> 31);
+		c2 = -(g & 1);
+		// x, y, z = f, u, v conditionally negated
+		x = (f ^ c1) - c1;
+		y = (u ^ c1) - c1;
+		z = (v ^ c1) - c1;
+		// conditionally add x, y, z to g, q, r
+		g += x & c2;
+		q += y & c2;
+		r += z & c2;
+		// c1 = (zeta < 0 && g odd) mask
+		c1 &= c2;
+		// zeta = -zeta - 2 or zeta - 1
+		zeta = (zeta ^ (int32_t)c1) - 1;
+		// conditionally add g, q, r to f, u, v
+		f += g & c1;
+		u += q & c1;
+		v += r & c1;
+		g >>= 1;
+		u <<= 1;
+		v <<= 1;
+	}
+	t->u = (int32_t)u;
+	t->v = (int32_t)v;
+	t->q = (int32_t)q;
+	t->r = (int32_t)r;
+	return zeta;
+}
+
+// [d, e] = t * [d, e] / 2^30 (mod prime), where a multiple of prime is
+// added to make the division exact.  pinv = prime^-1 mod 2^30.
+// d and e are in range (-2*prime, prime) before and after.
+void bn_update_de_30(bn_signed30 *d, bn_signed30 *e, const bn_trans2x2 *t, const bignum256 *prime, uint32_t pinv)
+{
+	const int32_t u = t->u, v = t->v, q = t->q, r = t->r;
+	int32_t di, ei, md, me, sd, se;
+	int64_t cd, ce;
+	int i;
+
+	// md, me = multiples of prime to add: start with [u, q] if d is
+	// negative and [v, r] if e is negative, to keep results in range.
+	sd = d->v[8] >> 31;
+	se = e->v[8] >> 31;
+	md = (u & sd) + (v & se);
+	me = (q & sd) + (r & se);
+	di = d->v[0];
+	ei = e->v[0];
+	cd = (int64_t)u * di + (int64_t)v * ei;
+	ce = (int64_t)q * di + (int64_t)r * ei;
+	// correct md, me so that the lowest 30 bits become zero
+	md -= (pinv * (uint32_t)cd + md) & 0x3FFFFFFF;
+	me -= (pinv * (uint32_t)ce + me) & 0x3FFFFFFF;
+	cd += (int64_t)prime->val[0] * md;
+	ce += (int64_t)prime->val[0] * me;
+	assert(((int32_t)cd & 0x3FFFFFFF) == 0);
+	assert(((int32_t)ce & 0x3FFFFFFF) == 0);
+	cd >>= 30;
+	ce >>= 30;
+	for (i = 1; i < 9; i++) {
+		di = d->v[i];
+		ei = e->v[i];
+		cd += (int64_t)u * di + (int64_t)v * ei + (int64_t)prime->val[i] * md;
+		ce += (int64_t)q * di + (int64_t)r * ei + (int64_t)prime->val[i] * me;
+		d->v[i - 1] = (int32_t)cd & 0x3FFFFFFF;
+		e->v[i - 1] = (int32_t)ce & 0x3FFFFFFF;
+		cd >>= 30;
+		ce >>= 30;
+	}
+	d->v[8] = (int32_t)cd;
+	e->v[8] = (int32_t)ce;
+}
+
+// [f, g] = t * [f, g] / 2^30, the division is exact.
+void bn_update_fg_30(bn_signed30 *f, bn_signed30 *g, const bn_trans2x2 *t)
+{
+	const int32_t u = t->u, v = t->v, q = t->q, r = t->r;
+	int32_t fi, gi;
+	int64_t cf, cg;
+	int i;
+
+	fi = f->v[0];
+	gi = g->v[0];
+	cf = (int64_t)u * fi + (int64_t)v * gi;
+	cg = (int64_t)q * fi + (int64_t)r * gi;
+	assert(((int32_t)cf & 0x3FFFFFFF) == 0);
+	assert(((int32_t)cg & 0x3FFFFFFF) == 0);
+	cf >>= 30;
+	cg >>= 30;
+	for (i = 1; i < 9; i++) {
+		fi = f->v[i];
+		gi = g->v[i];
+		cf += (int64_t)u * fi + (int64_t)v * gi;
+		cg += (int64_t)q * fi + (int64_t)r * gi;
+		f->v[i - 1] = (int32_t)cf & 0x3FFFFFFF;
+		g->v[i - 1] = (int32_t)cg & 0x3FFFFFFF;
+		cf >>= 30;
+		cg >>= 30;
+	}
+	f->v[8] = (int32_t)cf;
+	g->v[8] = (int32_t)cg;
+}
+
+// add prime to a if a is negative and propagate the carries.
+// a must be in range (-prime, prime) afterwards.
+void bn_signed30_add_if_negative(bn_signed30 *a, const bignum256 *prime)
+{
+	int i;
+	int32_t cond = a->v[8] >> 31;
+	for (i = 0; i < 9; i++) {
+		a->v[i] += (int32_t)prime->val[i] & cond;
+	}
+	for (i = 0; i < 8; i++) {
+		a->v[i + 1] += a->v[i] >> 30;
+		a->v[i] &= 0x3FFFFFFF;
+	}
+}
+
+// in field G_prime, constant time
+// the input must be partly reduced and not 0 mod prime.
+// the result is smaller than prime
+void bn_inverse(bignum256 *x, const bignum256 *prime)
+{
+	bn_signed30 d, e, f, g;
+	bn_trans2x2 t;
+	int32_t zeta = -1, sign;
+	uint32_t pinv;
+	int i;
+
+	// pinv = prime^-1 mod 2^30 by Newton iteration
+	pinv = prime->val[0];
+	for (i = 0; i < 4; i++) {
+		pinv *= 2 - prime->val[0] * pinv;
+	}
+	pinv &= 0x3FFFFFFF;
+
+	memset(&d, 0, sizeof(d));
+	memset(&e, 0, sizeof(e));
+	e.v[0] = 1;
+	// g = x - prime, made non-negative again, so g < prime
+	for (i = 0; i < 9; i++) {
+		f.v[i] = prime->val[i];
+		g.v[i] = (int32_t)x->val[i] - (int32_t)prime->val[i];
+	}
+	for (i = 0; i < 8; i++) {
+		g.v[i + 1] += g.v[i] >> 30;
+		g.v[i] &= 0x3FFFFFFF;
+	}
+	bn_signed30_add_if_negative(&g, prime);
+
+	// 20*30 = 600 divsteps are enough for 256-bit numbers, after that
+	// g = 0, f = +-1 and d = +-x^-1.
+	for (i = 0; i < 20; i++) {
+		zeta = bn_divsteps_30(zeta, f.v[0], g.v[0], &t);
+		bn_update_de_30(&d, &e, &t, prime, pinv);
+		bn_update_fg_30(&f, &g, &t);
+	}
+
+	// bring d from (-2*prime, prime) into [0, prime) and fix the sign
+	bn_signed30_add_if_negative(&d, prime);
+	sign = f.v[8] >> 31;
+	for (i = 0; i < 9; i++) {
+		d.v[i] = (d.v[i] ^ sign) - sign;
+	}
+	for (i = 0; i < 8; i++) {
+		d.v[i + 1] += d.v[i] >> 30;
+		d.v[i] &= 0x3FFFFFFF;
+	}
+	bn_signed30_add_if_negative(&d, prime);
+
+	for (i = 0; i < 9; i++) {
+		x->val[i] = (uint32_t)d.v[i];
+	}
+	MEMSET_BZERO(&d, sizeof(d));
+	MEMSET_BZERO(&e, sizeof(e));
+	MEMSET_BZERO(&f, sizeof(f));
+	MEMSET_BZERO(&g, sizeof(g));
+	MEMSET_BZERO(&t, sizeof(t));
+}
+
+#elif ! USE_INVERSE_FAST
 
 // in field G_prime, small but slow
 void bn_inverse(bignum256 *x, const bignum256 *prime)
@@ -821,6 +1174,37 @@ void bn_divmod58(bignum256 *a, uint32_t *r)
 	*r = rem;
 }
 
+// compute the width-5 non-adjacent form of k, i.e.,
+//   k = sum_{i=0..len-1} naf[i] 2^i
+// where every naf[i] is either zero or odd with |naf[i]| < 16, and
+// of any five consecutive digits at most one is non-zero.
+// k must be normalized.  Returns len, which is at most 257.
+// This function is not constant time; only use it for public scalars.
+int bn_wnaf5(const bignum256 *k, int8_t naf[257])
+{
+	int len = 0;
+	int32_t digit;
+	bignum256 a = *k;
+
+	memset(naf, 0, 257);
+	while (!bn_is_zero(&a)) {
+		if (a.val[0] & 1) {
+			// digit = a mod 32 in range [-15, 15]
+			digit = a.val[0] & 31;
+			if (digit >= 16) {
+				digit -= 32;
+				bn_addi(&a, -digit);
+			} else {
+				a.val[0] -= digit;
+			}
+			naf[len] = digit;
+		}
+		bn_rshift(&a);
+		len++;
+	}
+	return len;
+}
+
 #if USE_BN_PRINT
 void bn_print(const bignum256 *a)
 {
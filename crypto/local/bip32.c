@@ -51,6 +51,11 @@ int hdnode_from_xpub(uint32_t depth, uint32_t fingerprint, uint32_t child_num, c
 }
 
 int hdnode_from_xprv(uint32_t depth, uint32_t fingerprint, uint32_t child_num, const uint8_t *chain_code, const uint8_t *private_key, HDNode *out)
+{
+	return hdnode_from_xprv_ctx(0, depth, fingerprint, child_num, chain_code, private_key, out);
+}
+
+int hdnode_from_xprv_ctx(const crypto_ctx *ctx, uint32_t depth, uint32_t fingerprint, uint32_t child_num, const uint8_t *chain_code, const uint8_t *private_key, HDNode *out)
 {
 	bignum256 a;
 	bn_read_be(private_key, &a);
@@ -74,11 +79,16 @@ int hdnode_from_xprv(uint32_t depth, uint32_t fingerprint, uint32_t child_num, c
 	out->child_num = child_num;
 	memcpy(out->chain_code, chain_code, 32);
 	memcpy(out->private_key, private_key, 32);
-	hdnode_fill_public_key(out);
+	hdnode_fill_public_key_ctx(ctx, out);
 	return 1;
 }
 
 int hdnode_from_seed(const uint8_t *seed, int seed_len, HDNode *out)
+{
+	return hdnode_from_seed_ctx(0, seed, seed_len, out);
+}
+
+int hdnode_from_seed_ctx(const crypto_ctx *ctx, const uint8_t *seed, int seed_len, HDNode *out)
 {
 	uint8_t I[32 + 32];
 	memset(out, 0, sizeof(HDNode));
@@ -102,18 +112,21 @@ int hdnode_from_seed(const uint8_t *seed, int seed_len, HDNode *out)
 
 	if (!failed) {
 		memcpy(out->chain_code, I + 32, 32);
-		hdnode_fill_public_key(out);
+		hdnode_fill_public_key_ctx(ctx, out);
 	}
 
 	MEMSET_BZERO(I, sizeof(I));
 	return failed ? 0 : 1;
 }
 
-int hdnode_private_ckd(HDNode *inout, uint32_t i)
+// derive the child i of inout, but leave the public key of the child
+// unset.  inout->public_key must be valid if i is not hardened or if
+// fingerprint is set; otherwise the fingerprint is left unchanged.
+static int hdnode_private_ckd_step(HDNode *inout, uint32_t i, bool fingerprint)
 {
 	uint8_t data[1 + 32 + 4];
 	uint8_t I[32 + 32];
-	uint8_t fingerprint[32];
+	uint8_t hash[32];
 	bignum256 a, b;
 
 	if (i & 0x80000000) { // private derivation
@@ -124,9 +137,10 @@ int hdnode_private_ckd(HDNode *inout, uint32_t i)
 	}
 	write_be(data + 33, i);
 
-	sha256_Raw(inout->public_key, 33, fingerprint);
-	ripemd160(fingerprint, 32, fingerprint);
-	inout->fingerprint = (fingerprint[0] << 24) + (fingerprint[1] << 16) + (fingerprint[2] << 8) + fingerprint[3];
+	if (fingerprint) {
+		hash160(inout->public_key, 33, hash);
+		inout->fingerprint = (hash[0] << 24) + (hash[1] << 16) + (hash[2] << 8) + hash[3];
+	}
 
 	bn_read_be(inout->private_key, &a);
 
@@ -152,19 +166,60 @@ int hdnode_private_ckd(HDNode *inout, uint32_t i)
 		inout->depth++;
 		inout->child_num = i;
 		bn_write_be(&a, inout->private_key);
-		hdnode_fill_public_key(inout);
 	}
 
 	// making sure to wipe our memory
 	MEMSET_BZERO(&a, sizeof(a));
 	MEMSET_BZERO(&b, sizeof(b));
 	MEMSET_BZERO(I, sizeof(I));
-	MEMSET_BZERO(fingerprint, sizeof(fingerprint));
+	MEMSET_BZERO(hash, sizeof(hash));
 	MEMSET_BZERO(data, sizeof(data));
 	return failed ? 0 : 1;
 }
 
+int hdnode_private_ckd(HDNode *inout, uint32_t i)
+{
+	return hdnode_private_ckd_ctx(0, inout, i);
+}
+
+int hdnode_private_ckd_ctx(const crypto_ctx *ctx, HDNode *inout, uint32_t i)
+{
+	if (hdnode_private_ckd_step(inout, i, true) == 0) return 0;
+	hdnode_fill_public_key_ctx(ctx, inout);
+	return 1;
+}
+
+int hdnode_private_ckd_path(HDNode *inout, const uint32_t *i, size_t i_count)
+{
+	return hdnode_private_ckd_path_ctx(0, inout, i, i_count);
+}
+
+int hdnode_private_ckd_path_ctx(const crypto_ctx *ctx, HDNode *inout, const uint32_t *i, size_t i_count)
+{
+	size_t k;
+	bool last;
+
+	// the public keys of intermediate nodes are only computed when a
+	// non-hardened child or the fingerprint of the final node needs them.
+	for (k = 0; k < i_count; k++) {
+		last = (k == i_count - 1);
+		if (k > 0 && (last || !(i[k] & 0x80000000))) {
+			hdnode_fill_public_key_ctx(ctx, inout);
+		}
+		if (hdnode_private_ckd_step(inout, i[k], last) == 0) return 0;
+	}
+	if (i_count > 0) {
+		hdnode_fill_public_key_ctx(ctx, inout);
+	}
+	return 1;
+}
+
 int hdnode_public_ckd(HDNode *inout, uint32_t i)
+{
+	return hdnode_public_ckd_ctx(0, inout, i);
+}
+
+int hdnode_public_ckd_ctx(const crypto_ctx *ctx, HDNode *inout, uint32_t i)
 {
 	uint8_t data[1 + 32 + 4];
 	uint8_t I[32 + 32];
@@ -179,8 +234,7 @@ int hdnode_public_ckd(HDNode *inout, uint32_t i)
 	}
 	write_be(data + 33, i);
 
-	sha256_Raw(inout->public_key, 33, fingerprint);
-	ripemd160(fingerprint, 32, fingerprint);
+	hash160(inout->public_key, 33, fingerprint);
 	inout->fingerprint = (fingerprint[0] << 24) + (fingerprint[1] << 16) + (fingerprint[2] << 8) + fingerprint[3];
 
 	memset(inout->private_key, 0, 32);
@@ -200,9 +254,10 @@ int hdnode_public_ckd(HDNode *inout, uint32_t i)
 	}
 
 	if (!failed) {
-		scalar_multiply(default_curve, &c, &b); // b = c * G
-		point_add(default_curve, &a, &b);       // b = a + b
-		if (!ecdsa_validate_pubkey(default_curve, &b)) {
+		// b = c * G + a.  a was validated by ecdsa_read_pubkey, so b
+		// is on the curve and only the point at infinity is invalid.
+		scalar_multiply_add_ctx(ctx, default_curve, &c, &a, &b);
+		if (point_is_infinity(&b)) {
 			failed = true;
 		}
 	}
@@ -227,66 +282,302 @@ int hdnode_public_ckd(HDNode *inout, uint32_t i)
 
 #if USE_BIP32_CACHE
 
-static bool private_ckd_cache_root_set = false;
-static HDNode private_ckd_cache_root;
-static int private_ckd_cache_index = 0;
+// the caches used by a null ctx, see crypto_ctx.h
+static bip32_private_cache private_ckd_cache;
+static bip32_public_cache public_ckd_cache;
+static const crypto_ctx default_ctx = {0, 0, &private_ckd_cache, &public_ckd_cache};
+
+// The cache is a trie of derivation path prefixes.  Every entry holds
+// the node for one path prefix and points to the entry of its parent
+// prefix (or -1 for the root).  Entries are partitioned by the root
+// node they were derived from, so e.g. a passphrase session does not
+// evict the nodes of the session without passphrase.
+//
+// Entries are only used as parents of further derivations, so their
+// fingerprint is not maintained and their public key is computed on
+// demand (see public_key_set).
+//
+// Eviction is least recently used.  Using an entry also marks all its
+// ancestors, so the oldest entry with the largest depth is always a leaf.
+
+// find the partition for root, or set up a new one
+static int private_ckd_cache_get_root(bip32_private_cache *cache, const HDNode *root)
+{
+	int j, r = 0;
+	for (j = 0; j < BIP32_CACHE_ROOTS; j++) {
+		if (cache->root[j].set && memcmp(&cache->root[j].node, root, sizeof(HDNode)) == 0) {
+			cache->root[j].stamp = cache->stamp;
+			return j;
+		}
+		if (!cache->root[j].set) {
+			r = j;
+		} else if (cache->root[r].set && cache->root[j].stamp < cache->root[r].stamp) {
+			r = j;
+		}
+	}
+	// clear the least recently used partition
+	for (j = 0; j < BIP32_CACHE_SIZE; j++) {
+		if (cache->entry[j].set && cache->entry[j].root == r) {
+			MEMSET_BZERO(&cache->entry[j], sizeof(cache->entry[j]));
+		}
+	}
+	cache->root[r].set = true;
+	cache->root[r].stamp = cache->stamp;
+	memcpy(&cache->root[r].node, root, sizeof(HDNode));
+	return r;
+}
+
+// find the child i of entry parent in partition root
+static int private_ckd_cache_find(bip32_private_cache *cache, int root, int parent, uint32_t i)
+{
+	int j;
+	for (j = 0; j < BIP32_CACHE_SIZE; j++) {
+		if (cache->entry[j].set &&
+		    cache->entry[j].root == root &&
+		    cache->entry[j].parent == parent &&
+		    cache->entry[j].i == i) {
+			return j;
+		}
+	}
+	return -1;
+}
+
+// store node as child i of entry parent.  Returns the new entry or -1
+// if every entry is in use by the current derivation.
+static int private_ckd_cache_add(bip32_private_cache *cache, int root, int parent, size_t depth, uint32_t i, const HDNode *node)
+{
+	int j, e = -1;
+	for (j = 0; j < BIP32_CACHE_SIZE; j++) {
+		if (!cache->entry[j].set) {
+			e = j;
+			break;
+		}
+		if (cache->entry[j].stamp == cache->stamp) {
+			continue;
+		}
+		if (e < 0 || cache->entry[j].stamp < cache->entry[e].stamp ||
+		    (cache->entry[j].stamp == cache->entry[e].stamp && cache->entry[j].depth > cache->entry[e].depth)) {
+			e = j;
+		}
+	}
+	if (e < 0) {
+		return -1;
+	}
+	MEMSET_BZERO(&cache->entry[e], sizeof(cache->entry[e]));
+	cache->entry[e].set = true;
+	cache->entry[e].root = root;
+	cache->entry[e].parent = parent;
+	cache->entry[e].depth = depth;
+	cache->entry[e].i = i;
+	cache->entry[e].stamp = cache->stamp;
+	memcpy(&cache->entry[e].node, node, sizeof(HDNode));
+	return e;
+}
+
+void hdnode_private_ckd_cache_clear(void)
+{
+	hdnode_private_ckd_cache_clear_ctx(0);
+}
 
-static struct {
-	bool set;
-	size_t depth;
-	uint32_t i[BIP32_CACHE_MAXDEPTH];
-	HDNode node;
-} private_ckd_cache[BIP32_CACHE_SIZE];
+void hdnode_private_ckd_cache_clear_ctx(const crypto_ctx *ctx)
+{
+	if (!ctx) {
+		ctx = &default_ctx;
+	}
+	if (ctx->private_cache) {
+		MEMSET_BZERO(ctx->private_cache, sizeof(bip32_private_cache));
+	}
+}
 
 int hdnode_private_ckd_cached(HDNode *inout, const uint32_t *i, size_t i_count)
 {
+	return hdnode_private_ckd_cached_ctx(0, inout, i, i_count);
+}
+
+int hdnode_private_ckd_cached_ctx(const crypto_ctx *ctx, HDNode *inout, const uint32_t *i, size_t i_count)
+{
+	if (!ctx) {
+		ctx = &default_ctx;
+	}
+	if (!ctx->private_cache) {
+		return hdnode_private_ckd_path_ctx(ctx, inout, i, i_count);
+	}
 	if (i_count == 0) {
 		return 1;
 	}
 	if (i_count == 1) {
-		if (hdnode_private_ckd(inout, i[0]) == 0) return 0;
+		if (hdnode_private_ckd_ctx(ctx, inout, i[0]) == 0) return 0;
 		return 1;
 	}
 
-	bool found = false;
-	// if root is not set or not the same
-	if (!private_ckd_cache_root_set || memcmp(&private_ckd_cache_root, inout, sizeof(HDNode)) != 0) {
-		// clear the cache
-		private_ckd_cache_index = 0;
-		memset(private_ckd_cache, 0, sizeof(private_ckd_cache));
-		// setup new root
-		memcpy(&private_ckd_cache_root, inout, sizeof(HDNode));
-		private_ckd_cache_root_set = true;
-	} else {
-		// try to find parent
-		int j;
-		for (j = 0; j < BIP32_CACHE_SIZE; j++) {
-			if (private_ckd_cache[j].set &&
-			    private_ckd_cache[j].depth == i_count - 1 &&
-			    memcmp(private_ckd_cache[j].i, i, (i_count - 1) * sizeof(uint32_t)) == 0) {
-				memcpy(inout, &(private_ckd_cache[j].node), sizeof(HDNode));
-				found = true;
-				break;
+	bip32_private_cache *cache = ctx->private_cache;
+	int root, parent = -1, e;
+	bool public_key_set = true;
+	size_t k = 0;
+
+	cache->stamp++;
+	root = private_ckd_cache_get_root(cache, inout);
+
+	// find the longest cached prefix of the parent path
+	while (k < i_count - 1 && (e = private_ckd_cache_find(cache, root, parent, i[k])) >= 0) {
+		cache->entry[e].stamp = cache->stamp;
+		parent = e;
+		k++;
+	}
+	if (parent >= 0) {
+		memcpy(inout, &(cache->entry[parent].node), sizeof(HDNode));
+		public_key_set = cache->entry[parent].public_key_set;
+	}
+
+	// derive the rest of the parent path and cache every new prefix
+	for (; k < i_count - 1; k++) {
+		if (!public_key_set && !(i[k] & 0x80000000)) {
+			hdnode_fill_public_key_ctx(ctx, inout);
+			public_key_set = true;
+			if (parent >= 0) {
+				memcpy(cache->entry[parent].node.public_key, inout->public_key, 33);
+				cache->entry[parent].public_key_set = true;
 			}
 		}
+		if (hdnode_private_ckd_step(inout, i[k], false) == 0) return 0;
+		public_key_set = false;
+		// a prefix can only be cached if its parent prefix is cached
+		if (k < BIP32_CACHE_MAXDEPTH && (k == 0 || parent >= 0)) {
+			parent = private_ckd_cache_add(cache, root, parent, k + 1, i[k], inout);
+		} else {
+			parent = -1;
+		}
 	}
 
-	// else derive parent
-	if (!found) {
-		size_t k;
-		for (k = 0; k < i_count - 1; k++) {
-			if (hdnode_private_ckd(inout, i[k]) == 0) return 0;
+	// the fingerprint of the child needs the public key of the parent
+	if (!public_key_set) {
+		hdnode_fill_public_key_ctx(ctx, inout);
+		if (parent >= 0) {
+			memcpy(cache->entry[parent].node.public_key, inout->public_key, 33);
+			cache->entry[parent].public_key_set = true;
 		}
-		// and save it
-		memset(&(private_ckd_cache[private_ckd_cache_index]), 0, sizeof(private_ckd_cache[private_ckd_cache_index]));
-		private_ckd_cache[private_ckd_cache_index].set = true;
-		private_ckd_cache[private_ckd_cache_index].depth = i_count - 1;
-		memcpy(private_ckd_cache[private_ckd_cache_index].i, i, (i_count - 1) * sizeof(uint32_t));
-		memcpy(&(private_ckd_cache[private_ckd_cache_index].node), inout, sizeof(HDNode));
-		private_ckd_cache_index = (private_ckd_cache_index + 1) % BIP32_CACHE_SIZE;
 	}
 
-	if (hdnode_private_ckd(inout, i[i_count - 1]) == 0) return 0;
+	if (hdnode_private_ckd_ctx(ctx, inout, i[i_count - 1]) == 0) return 0;
+
+	return 1;
+}
+
+// Cache for public derivation from extended public keys, e.g. the
+// xpubs of multisig cosigners.  Roots are identified by chain code and
+// public key, entries by their root and the derivation path.  Every
+// entry is independent, so any entry can be evicted; using a path
+// marks all cached prefixes of it.
+
+// find the partition for root, or set up a new one
+static int public_ckd_cache_get_root(bip32_public_cache *cache, const HDNode *root)
+{
+	int j, r = 0;
+	for (j = 0; j < BIP32_PUBLIC_CACHE_ROOTS; j++) {
+		if (cache->root[j].set &&
+		    memcmp(cache->root[j].chain_code, root->chain_code, 32) == 0 &&
+		    memcmp(cache->root[j].public_key, root->public_key, 33) == 0) {
+			cache->root[j].stamp = cache->stamp;
+			return j;
+		}
+		if (!cache->root[j].set) {
+			r = j;
+		} else if (cache->root[r].set && cache->root[j].stamp < cache->root[r].stamp) {
+			r = j;
+		}
+	}
+	// drop the entries of the least recently used root
+	for (j = 0; j < BIP32_PUBLIC_CACHE_SIZE; j++) {
+		if (cache->entry[j].set && cache->entry[j].root == r) {
+			memset(&cache->entry[j], 0, sizeof(cache->entry[j]));
+		}
+	}
+	cache->root[r].set = true;
+	cache->root[r].stamp = cache->stamp;
+	memcpy(cache->root[r].chain_code, root->chain_code, 32);
+	memcpy(cache->root[r].public_key, root->public_key, 33);
+	return r;
+}
+
+static void public_ckd_cache_add(bip32_public_cache *cache, int root, const uint32_t *i, size_t depth, const HDNode *node)
+{
+	int j, e = 0;
+	for (j = 0; j < BIP32_PUBLIC_CACHE_SIZE; j++) {
+		if (!cache->entry[j].set) {
+			e = j;
+			break;
+		}
+		if (cache->entry[j].stamp < cache->entry[e].stamp) {
+			e = j;
+		}
+	}
+	cache->entry[e].set = true;
+	cache->entry[e].root = root;
+	cache->entry[e].depth = depth;
+	memcpy(cache->entry[e].i, i, depth * sizeof(uint32_t));
+	cache->entry[e].stamp = cache->stamp;
+	cache->entry[e].fingerprint = node->fingerprint;
+	memcpy(cache->entry[e].chain_code, node->chain_code, 32);
+	memcpy(cache->entry[e].public_key, node->public_key, 33);
+}
+
+int hdnode_public_ckd_cached(HDNode *inout, const uint32_t *i, size_t i_count)
+{
+	return hdnode_public_ckd_cached_ctx(0, inout, i, i_count);
+}
+
+int hdnode_public_ckd_cached_ctx(const crypto_ctx *ctx, HDNode *inout, const uint32_t *i, size_t i_count)
+{
+	bip32_public_cache *cache;
+	int root, j, found = -1;
+	size_t k = 0;
+
+	if (!ctx) {
+		ctx = &default_ctx;
+	}
+	cache = ctx->public_cache;
+	if (!cache) {
+		for (; k < i_count; k++) {
+			if (hdnode_public_ckd_ctx(ctx, inout, i[k]) == 0) return 0;
+		}
+		return 1;
+	}
+	if (i_count == 0) {
+		return 1;
+	}
+
+	cache->stamp++;
+	root = public_ckd_cache_get_root(cache, inout);
+
+	// find the longest cached prefix of the path
+	for (j = 0; j < BIP32_PUBLIC_CACHE_SIZE; j++) {
+		if (cache->entry[j].set &&
+		    cache->entry[j].root == root &&
+		    cache->entry[j].depth <= i_count &&
+		    memcmp(cache->entry[j].i, i, cache->entry[j].depth * sizeof(uint32_t)) == 0) {
+			cache->entry[j].stamp = cache->stamp;
+			if (found < 0 || cache->entry[j].depth > cache->entry[found].depth) {
+				found = j;
+			}
+		}
+	}
+	if (found >= 0) {
+		k = cache->entry[found].depth;
+		inout->depth += k;
+		inout->fingerprint = cache->entry[found].fingerprint;
+		inout->child_num = i[k - 1];
+		memcpy(inout->chain_code, cache->entry[found].chain_code, 32);
+		memcpy(inout->public_key, cache->entry[found].public_key, 33);
+		// as hdnode_public_ckd does
+		memset(inout->private_key, 0, 32);
+	}
+
+	for (; k < i_count; k++) {
+		if (hdnode_public_ckd_ctx(ctx, inout, i[k]) == 0) return 0;
+		if (k < BIP32_CACHE_MAXDEPTH) {
+			public_ckd_cache_add(cache, root, i, k + 1, inout);
+		}
+	}
 
 	return 1;
 }
@@ -295,7 +586,12 @@ int hdnode_private_ckd_cached(HDNode *inout, const uint32_t *i, size_t i_count)
 
 void hdnode_fill_public_key(HDNode *node)
 {
-	ecdsa_get_public_key33(default_curve, node->private_key, node->public_key);
+	hdnode_fill_public_key_ctx(0, node);
+}
+
+void hdnode_fill_public_key_ctx(const crypto_ctx *ctx, HDNode *node)
+{
+	ecdsa_get_public_key33_ctx(ctx, default_curve, node->private_key, node->public_key);
 }
 
 void hdnode_serialize(const HDNode *node, uint32_t version, char use_public, char *str, int strsize)
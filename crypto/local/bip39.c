@@ -28,6 +28,7 @@
 #include "rand.h"
 #include "sha2.h"
 #include "pbkdf2.h"
+#include "macros.h"
 #include "bip39_english.h"
 
 const char *mnemonic_generate(int strength)
@@ -74,75 +75,101 @@ const char *mnemonic_from_data(const uint8_t *data, int len)
 	return mnemo;
 }
 
-int mnemonic_check(const char *mnemonic)
+void mnemonic_ctx_init(MNEMONIC_CTX *ctx)
 {
-	if (!mnemonic) {
+	memset(ctx, 0, sizeof(MNEMONIC_CTX));
+}
+
+int mnemonic_ctx_add_word(MNEMONIC_CTX *ctx, uint32_t pos, const char *word)
+{
+	int idx = mnemonic_word_index(word);
+	if (pos >= 24 || idx < 0) {
 		return 0;
 	}
+	uint32_t ki, bi = pos * 11;
+	for (ki = 0; ki < 11; ki++, bi++) {
+		if (idx & (1 << (10 - ki))) {
+			ctx->bits[bi / 8] |= 1 << (7 - (bi % 8));
+		} else {
+			ctx->bits[bi / 8] &= ~(1 << (7 - (bi % 8)));
+		}
+	}
+	ctx->words |= 1 << pos;
+	return 1;
+}
 
-	uint32_t i, n;
+int mnemonic_ctx_check(const MNEMONIC_CTX *ctx)
+{
+	uint32_t n;
+	uint8_t hash[32];
+	int res;
 
-	i = 0; n = 0;
-	while (mnemonic[i]) {
-		if (mnemonic[i] == ' ') {
-			n++;
-		}
-		i++;
+	// the words have to be exactly the first 12, 18 or 24
+	if (ctx->words == (1 << 12) - 1) {
+		n = 12;
+	} else
+	if (ctx->words == (1 << 18) - 1) {
+		n = 18;
+	} else
+	if (ctx->words == (1 << 24) - 1) {
+		n = 24;
+	} else {
+		return 0;
 	}
-	n++;
-	// check number of words
-	if (n != 12 && n != 18 && n != 24) {
+	// the first n * 32 / 3 bits are the entropy, then n / 3 checksum bits
+	sha256_Raw(ctx->bits, n * 4 / 3, hash);
+	if (n == 12) {
+		res = (hash[0] & 0xF0) == (ctx->bits[16] & 0xF0); // compare first 4 bits
+	} else
+	if (n == 18) {
+		res = (hash[0] & 0xFC) == (ctx->bits[24] & 0xFC); // compare first 6 bits
+	} else {
+		res = hash[0] == ctx->bits[32]; // compare 8 bits
+	}
+	MEMSET_BZERO(hash, sizeof(hash));
+	return res;
+}
+
+int mnemonic_check(const char *mnemonic)
+{
+	if (!mnemonic) {
 		return 0;
 	}
 
 	char current_word[10];
-	uint32_t j, k, ki, bi;
-	uint8_t bits[32 + 1];
-	memset(bits, 0, sizeof(bits));
-	i = 0; bi = 0;
+	uint32_t i, j, n;
+	MNEMONIC_CTX ctx;
+	int res = 0;
+
+	mnemonic_ctx_init(&ctx);
+	i = 0; n = 0;
 	while (mnemonic[i]) {
 		j = 0;
 		while (mnemonic[i] != ' ' && mnemonic[i] != 0) {
 			if (j >= sizeof(current_word) - 1) {
-				return 0;
+				goto done;
 			}
 			current_word[j] = mnemonic[i];
 			i++; j++;
 		}
 		current_word[j] = 0;
-		if (mnemonic[i] != 0) i++;
-		k = 0;
-		for (;;) {
-			if (!wordlist[k]) { // word not found
-				return 0;
-			}
-			if (strcmp(current_word, wordlist[k]) == 0) { // word found on index k
-				for (ki = 0; ki < 11; ki++) {
-					if (k & (1 << (10 - ki))) {
-						bits[bi / 8] |= 1 << (7 - (bi % 8));
-					}
-					bi++;
-				}
-				break;
+		if (mnemonic[i] != 0) {
+			i++;
+			// a separator must be followed by a word
+			if (mnemonic[i] == 0) {
+				goto done;
 			}
-			k++;
 		}
+		if (!mnemonic_ctx_add_word(&ctx, n, current_word)) {
+			goto done;
+		}
+		n++;
 	}
-	if (bi != n * 11) {
-		return 0;
-	}
-	bits[32] = bits[n * 4 / 3];
-	sha256_Raw(bits, n * 4 / 3, bits);
-	if (n == 12) {
-		return (bits[0] & 0xF0) == (bits[32] & 0xF0); // compare first 4 bits
-	} else
-	if (n == 18) {
-		return (bits[0] & 0xFC) == (bits[32] & 0xFC); // compare first 6 bits
-	} else
-	if (n == 24) {
-		return bits[0] == bits[32]; // compare 8 bits
-	}
-	return 0;
+	res = mnemonic_ctx_check(&ctx);
+done:
+	MEMSET_BZERO(&ctx, sizeof(ctx));
+	MEMSET_BZERO(current_word, sizeof(current_word));
+	return res;
 }
 
 // passphrase must be at most 256 characters or code may crash
@@ -160,3 +187,74 @@ const char * const *mnemonic_wordlist(void)
 {
 	return wordlist;
 }
+
+// the wordlist is sorted, so a binary search within the words that
+// share the first letter takes at most 8 comparisons
+int mnemonic_word_index(const char *word)
+{
+	if (word[0] < 'a' || word[0] > 'z') {
+		return -1;
+	}
+	int lo = wordlist_letter_start[word[0] - 'a'];
+	int hi = wordlist_letter_start[word[0] - 'a' + 1];
+	while (lo < hi) {
+		int mid = (lo + hi) / 2;
+		int c = strcmp(word, wordlist[mid]);
+		if (c == 0) {
+			return mid;
+		}
+		if (c < 0) {
+			hi = mid;
+		} else {
+			lo = mid + 1;
+		}
+	}
+	return -1;
+}
+
+// number of words whose first len letters compare below prefix
+// (or_equal == 0) or not above it (or_equal == 1).  It always probes
+// 11 words, so the time does not depend much on the prefix.
+static int wordlist_prefix_bound(const char *prefix, size_t len, int or_equal)
+{
+	int pos = 0, step, c;
+	for (step = 1024; step > 0; step >>= 1) {
+		c = strncmp(wordlist[pos + step - 1], prefix, len);
+		if (c < 0 || (or_equal && c == 0)) {
+			pos += step;
+		}
+	}
+	// the probes only reach the first 2047 words
+	c = strncmp(wordlist[pos], prefix, len);
+	if (pos == 2047 && (c < 0 || (or_equal && c == 0))) {
+		pos++;
+	}
+	return pos;
+}
+
+// The words starting with prefix are consecutive in the sorted
+// wordlist.  Returns how many there are and sets *first to the index
+// of the first one.  If prefix is itself a word, it is that first one.
+int mnemonic_prefix_range(const char *prefix, int *first)
+{
+	size_t len = strlen(prefix);
+	int lo = wordlist_prefix_bound(prefix, len, 0);
+	int hi = wordlist_prefix_bound(prefix, len, 1);
+	*first = lo;
+	return hi - lo;
+}
+
+// bit i is set if some word continues prefix with the letter 'a' + i
+uint32_t mnemonic_next_letters(const char *prefix)
+{
+	size_t len = strlen(prefix);
+	int i, first, count = mnemonic_prefix_range(prefix, &first);
+	uint32_t letters = 0;
+	for (i = first; i < first + count; i++) {
+		char c = wordlist[i][len];
+		if (c >= 'a' && c <= 'z') {
+			letters |= 1 << (c - 'a');
+		}
+	}
+	return letters;
+}
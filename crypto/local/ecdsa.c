@@ -193,13 +193,22 @@ typedef struct jacobian_curve_point {
 	bignum256 x, y, z;
 } jacobian_curve_point;
 
-void curve_to_jacobian(const curve_point *p, jacobian_curve_point *jp, const bignum256 *prime) {
+// next random word of the context, see crypto_ctx
+static uint32_t ctx_random32(const crypto_ctx *ctx)
+{
+	if (ctx && ctx->random32) {
+		return ctx->random32(ctx->random_state);
+	}
+	return random32();
+}
+
+void curve_to_jacobian(const crypto_ctx *ctx, const curve_point *p, jacobian_curve_point *jp, const bignum256 *prime) {
 	int i;
 	// randomize z coordinate
 	for (i = 0; i < 8; i++) {
-		jp->z.val[i] = random32() & 0x3FFFFFFF;
+		jp->z.val[i] = ctx_random32(ctx) & 0x3FFFFFFF;
 	}
-	jp->z.val[8] = (random32() & 0x7fff) + 1;
+	jp->z.val[8] = (ctx_random32(ctx) & 0x7fff) + 1;
 
 	jp->x = jp->z;
 	bn_multiply(&jp->z, &jp->x, prime);
@@ -416,8 +425,186 @@ void point_jacobian_double(jacobian_curve_point *p, const ecdsa_curve *curve) {
 	bn_fast_mod(&p->y, prime);
 }
 
+// compute the table of odd multiples pmult[i] = (2*i+1) * p
+// for i = 0..7, i.e., p, 3*p, ..., 15*p.
+void point_odd_multiples(const ecdsa_curve *curve, const curve_point *p, curve_point pmult[8])
+{
+	int i;
+	// store p^2 temporarily in pmult[7]
+	pmult[7] = *p;
+	point_double(curve, &pmult[7]);
+	// compute 3*p, etc by repeatedly adding p^2.
+	pmult[0] = *p;
+	for (i = 1; i < 8; i++) {
+		pmult[i] = pmult[7];
+		point_add(curve, &pmult[i-1], &pmult[i]);
+	}
+}
+
+#if USE_GLV
+
+// secp256k1 has an efficiently computable endomorphism
+//   phi(x, y) = (beta * x, y) = lambda * (x, y)
+// where beta is a cube root of unity modulo the prime and lambda a
+// cube root of unity modulo the order.  The constants for the
+// decomposition of scalars are taken from libsecp256k1.
+static const bignum256 secp256k1_beta = {{0x319501ee, 0x04e5b0a1, 0x2f58995c, 0x3c125d44, 0x3434e99c, 0x111e7ab0, 0x007106e6, 0x1a8ad95f, 0x7ae9}};
+static const bignum256 secp256k1_lambda = {{0x1b23bd72, 0x3c0a59f0, 0x0816678d, 0x0b88ba88, 0x12645a12, 0x18700a20, 0x030e0a52, 0x2b533017, 0x5363}};
+static const bignum256 secp256k1_minus_b1 = {{0x0abfe4c3, 0x3d51fea4, 0x10e88286, 0x10dfb580, 0x000000e4, 0x00000000, 0x00000000, 0x00000000, 0x0000}};
+static const bignum256 secp256k1_minus_b2 = {{0x3db1562c, 0x1d9736a0, 0x374346dd, 0x0a02b141, 0x3ffffe8a, 0x3fffffff, 0x3fffffff, 0x3fffffff, 0xffff}};
+static const bignum256 secp256k1_g1 = {{0x05dbb031, 0x224c8269, 0x1e8ca7fe, 0x2aa2851c, 0x04eb153d, 0x3243924a, 0x06bcde86, 0x348869f5, 0x3086}};
+static const bignum256 secp256k1_g2 = {{0x0ac47f71, 0x15c6d2ba, 0x1f506c61, 0x04822b27, 0x3fe4c422, 0x11fea42a, 0x288286f5, 0x1fb58043, 0xe443}};
+
+// split k into k1 + k2 * lambda (mod order) with |k1|, |k2| < 2^128.
+// k1 and k2 are returned as absolute values, sign1 and sign2 are set
+// to 0xffffffff if the corresponding part is negative, 0 otherwise.
+// The timing of this function does not depend on k.
+void secp256k1_glv_split(const bignum256 *k, bignum256 *k1, uint32_t *sign1, bignum256 *k2, uint32_t *sign2)
+{
+	const bignum256 *order = &secp256k1.order;
+	bignum256 c1, c2, half, neg;
+
+	// c1 = round(k * b2 / order), c2 = round(-k * b1 / order)
+	bn_multiply_shift(k, &secp256k1_g1, 384, &c1);
+	bn_multiply_shift(k, &secp256k1_g2, 384, &c2);
+
+	// k2 = -c1 * b1 - c2 * b2
+	bn_multiply(&secp256k1_minus_b1, &c1, order);
+	bn_multiply(&secp256k1_minus_b2, &c2, order);
+	bn_addmod(&c1, &c2, order);
+	bn_mod(&c1, order);
+	*k2 = c1;
+
+	// k1 = k - k2 * lambda
+	bn_multiply(&secp256k1_lambda, &c1, order);
+	bn_mod(&c1, order);
+	bn_subtractmod(k, &c1, k1, order);
+	bn_fast_mod(k1, order);
+	bn_mod(k1, order);
+
+	// numbers above order/2 represent negative values
+	half = *order;
+	bn_rshift(&half);
+
+	*sign1 = -(uint32_t)bn_is_less(&half, k1);
+	bn_subtract(order, k1, &neg);
+	bn_cmov(k1, *sign1 & 1, &neg, k1);
+
+	*sign2 = -(uint32_t)bn_is_less(&half, k2);
+	bn_subtract(order, k2, &neg);
+	bn_cmov(k2, *sign2 & 1, &neg, k2);
+
+	assert(k1->val[4] < 0x100 && k1->val[5] == 0);
+	assert(k2->val[4] < 0x100 && k2->val[5] == 0);
+	MEMSET_BZERO(&c1, sizeof(c1));
+	MEMSET_BZERO(&c2, sizeof(c2));
+	MEMSET_BZERO(&neg, sizeof(neg));
+}
+
+// get the signed digit a[i] of the recoding used by point_multiply
+// and return pmult index |a[i]| >> 1, sign is set to 0xffffffff if
+// a[i] is negative and to 0 otherwise.
+static uint32_t glv_digit(const bignum256 *a, int i, uint32_t *sign)
+{
+	int pos = i*4/30, shift = i*4 % 30;
+	uint32_t bits = (a->val[pos+1]<<(30-shift) | a->val[pos] >> shift) & 31;
+	*sign = (bits >> 4) - 1;
+	bits ^= *sign;
+	return (bits & 15) >> 1;
+}
+
+// res = k * p for the curve secp256k1, using the endomorphism to halve
+// the number of doublings.  This uses the same signed odd digit
+// recoding as point_multiply, applied to both halves of k, so its
+// timing does not depend on k either.
+void point_multiply_glv(const crypto_ctx *ctx, const ecdsa_curve *curve, const bignum256 *k, const curve_point *p, curve_point *res)
+{
+	int i, j;
+	bignum256 a[2];
+	uint32_t sign[2], is_even[2], dsign, idx;
+	jacobian_curve_point jres, jtmp;
+	curve_point pmult[2][8], q;
+	const bignum256 *prime = &curve->prime;
+
+	assert (bn_is_less(k, &curve->order));
+
+	// special case 0*p:  just return zero. We don't care about constant time.
+	if (bn_is_zero(k)) {
+		point_set_infinity(res);
+		return;
+	}
+
+	// k = s0 * a[0] + s1 * a[1] * lambda with signs s0, s1 and
+	// 0 <= a[0], a[1] < 2^128.
+	secp256k1_glv_split(k, &a[0], &sign[0], &a[1], &sign[1]);
+
+	// make both numbers odd by adding one if they are even; the
+	// extra s0 * p and s1 * lambda * p are subtracted at the end.
+	for (j = 0; j < 2; j++) {
+		is_even[j] = (a[j].val[0] & 1) - 1;
+		bn_addi(&a[j], is_even[j] & 1);
+		// add 2^128, so that a[j] = sum_{i=0..31} a[j][i] 16^i + 2^128
+		// with odd digits |a[j][i]| < 16 as in point_multiply.
+		a[j].val[4] += 1 << 8;
+	}
+
+	// pmult[0][i] = (2*i+1) * p, pmult[1][i] = (2*i+1) * lambda * p
+	point_odd_multiples(curve, p, pmult[0]);
+	for (i = 0; i < 8; i++) {
+		pmult[1][i] = pmult[0][i];
+		bn_multiply(&secp256k1_beta, &pmult[1][i].x, prime);
+		bn_mod(&pmult[1][i].x, prime);
+	}
+
+	// the highest digits are positive, since we added 2^128.
+	idx = glv_digit(&a[0], 31, &dsign);
+	q = pmult[0][idx];
+	conditional_negate(sign[0], &q.y, prime);
+	curve_to_jacobian(ctx, &q, &jres, prime);
+	idx = glv_digit(&a[1], 31, &dsign);
+	q = pmult[1][idx];
+	conditional_negate(sign[1], &q.y, prime);
+	point_jacobian_add(&q, &jres, curve);
+
+	for (i = 30; i >= 0; i--) {
+		point_jacobian_double(&jres, curve);
+		point_jacobian_double(&jres, curve);
+		point_jacobian_double(&jres, curve);
+		point_jacobian_double(&jres, curve);
+
+		for (j = 0; j < 2; j++) {
+			idx = glv_digit(&a[j], i, &dsign);
+			q = pmult[j][idx];
+			conditional_negate(dsign ^ sign[j], &q.y, prime);
+			point_jacobian_add(&q, &jres, curve);
+		}
+	}
+
+	// subtract the ones added to make the numbers odd.
+	for (j = 0; j < 2; j++) {
+		q = pmult[j][0];
+		conditional_negate(~sign[j], &q.y, prime);
+		jtmp = jres;
+		point_jacobian_add(&q, &jtmp, curve);
+		bn_cmov(&jres.x, is_even[j] & 1, &jtmp.x, &jres.x);
+		bn_cmov(&jres.y, is_even[j] & 1, &jtmp.y, &jres.y);
+		bn_cmov(&jres.z, is_even[j] & 1, &jtmp.z, &jres.z);
+	}
+
+	jacobian_to_curve(&jres, res, prime);
+	MEMSET_BZERO(a, sizeof(a));
+}
+
+#endif
+
 // res = k * p
 void point_multiply(const ecdsa_curve *curve, const bignum256 *k, const curve_point *p, curve_point *res)
+{
+	point_multiply_ctx(0, curve, k, p, res);
+}
+
+// res = k * p, blinded with random words from ctx
+void point_multiply_ctx(const crypto_ctx *ctx, const ecdsa_curve *curve, const bignum256 *k, const curve_point *p, curve_point *res)
 {
 	// this algorithm is loosely based on
 	//  Katsuyuki Okeya and Tsuyoshi Takagi, The Width-w NAF Method Provides
@@ -425,6 +612,13 @@ void point_multiply(const ecdsa_curve *curve, const bignum256 *k, const curve_po
 	//  Side Channel Attacks.
 	assert (bn_is_less(k, &curve->order));
 
+#if USE_GLV
+	if (curve == &secp256k1) {
+		point_multiply_glv(ctx, curve, k, p, res);
+		return;
+	}
+#endif
+
 	int i, j;
 	int pos, shift;
 	bignum256 a;
@@ -469,16 +663,7 @@ void point_multiply(const ecdsa_curve *curve, const bignum256 *k, const curve_po
 	//
 	// We compute |a[i]| * p in advance for all possible
 	// values of |a[i]| * p.  pmult[i] = (2*i+1) * p
-	// We compute p, 3*p, ..., 15*p and store it in the table pmult.
-	// store p^2 temporarily in pmult[7]
-	pmult[7] = *p;
-	point_double(curve, &pmult[7]);
-	// compute 3*p, etc by repeatedly adding p^2.
-	pmult[0] = *p;
-	for (i = 1; i < 8; i++) {
-		pmult[i] = pmult[7];
-		point_add(curve, &pmult[i-1], &pmult[i]);
-	}
+	point_odd_multiples(curve, p, pmult);
 
 	// now compute  res = sum_{i=0..63} a[i] * 16^i * p step by step,
 	// starting with i = 63.
@@ -491,7 +676,7 @@ void point_multiply(const ecdsa_curve *curve, const bignum256 *k, const curve_po
 	sign = (bits >> 4) - 1;
 	bits ^= sign;
 	bits &= 15;
-	curve_to_jacobian(&pmult[bits>>1], &jres, prime);
+	curve_to_jacobian(ctx, &pmult[bits>>1], &jres, prime);
 	for (i = 62; i >= 0; i--) {
 		// sign = sign(a[i+1])  (0xffffffff for negative, 0 for positive)
 		// invariant jres = (-1)^sign sum_{j=i+1..63} (a[j] * 16^{j-i-1} * p)
@@ -522,9 +707,10 @@ void point_multiply(const ecdsa_curve *curve, const bignum256 *k, const curve_po
 
 #if USE_PRECOMPUTED_CP
 
-// res = k * G
+// jres = k * G in jacobian coordinates
 // k must be a normalized number with 0 <= k < curve->order
-void scalar_multiply(const ecdsa_curve *curve, const bignum256 *k, curve_point *res)
+// returns 0 if k is zero and jres is not set.
+int scalar_multiply_jacobian(const crypto_ctx *ctx, const ecdsa_curve *curve, const bignum256 *k, jacobian_curve_point *jres)
 {
 	assert (bn_is_less(k, &curve->order));
 
@@ -532,7 +718,6 @@ void scalar_multiply(const ecdsa_curve *curve, const bignum256 *k, curve_point *
 	bignum256 a;
 	uint32_t is_even = (k->val[0] & 1) - 1;
 	uint32_t lowbits;
-	jacobian_curve_point jres;
 	const bignum256 *prime = &curve->prime;
 
 	// is_even = 0xffffffff if k is even, 0 otherwise.
@@ -553,8 +738,7 @@ void scalar_multiply(const ecdsa_curve *curve, const bignum256 *k, curve_point *
 
 	// special case 0*G:  just return zero. We don't care about constant time.
 	if (!is_non_zero) {
-		point_set_infinity(res);
-		return;
+		return 0;
 	}
 
 	// Now a = k + 2^256 (mod curve->order) and a is odd.
@@ -580,7 +764,7 @@ void scalar_multiply(const ecdsa_curve *curve, const bignum256 *k, curve_point *
 	lowbits = a.val[0] & ((1 << 5) - 1);
 	lowbits ^= (lowbits >> 4) - 1;
 	lowbits &= 15;
-	curve_to_jacobian(&curve->cp[0][lowbits >> 1], &jres, prime);
+	curve_to_jacobian(ctx, &curve->cp[0][lowbits >> 1], jres, prime);
 	for (i = 1; i < 64; i ++) {
 		// invariant res = sign(a[i-1]) sum_{j=0..i-1} (a[j] * 16^j * G)
 
@@ -597,32 +781,229 @@ void scalar_multiply(const ecdsa_curve *curve, const bignum256 *k, curve_point *
 		lowbits &= 15;
 		// negate last result to make signs of this round and the
 		// last round equal.
-		conditional_negate((lowbits & 1) - 1, &jres.y, prime);
+		conditional_negate((lowbits & 1) - 1, &jres->y, prime);
 
 		// add odd factor
-		point_jacobian_add(&curve->cp[i][lowbits >> 1], &jres, curve);
+		point_jacobian_add(&curve->cp[i][lowbits >> 1], jres, curve);
 	}
-	conditional_negate(((a.val[0] >> 4) & 1) - 1, &jres.y, prime);
-	jacobian_to_curve(&jres, res, prime);
+	conditional_negate(((a.val[0] >> 4) & 1) - 1, &jres->y, prime);
+	MEMSET_BZERO(&a, sizeof(a));
+	return 1;
+}
+
+// res = k * G
+// k must be a normalized number with 0 <= k < curve->order
+void scalar_multiply_ctx(const crypto_ctx *ctx, const ecdsa_curve *curve, const bignum256 *k, curve_point *res)
+{
+	jacobian_curve_point jres;
+	if (!scalar_multiply_jacobian(ctx, curve, k, &jres)) {
+		point_set_infinity(res);
+		return;
+	}
+	jacobian_to_curve(&jres, res, &curve->prime);
 }
 
 #else
 
+int scalar_multiply_jacobian(const crypto_ctx *ctx, const ecdsa_curve *curve, const bignum256 *k, jacobian_curve_point *jres)
+{
+	curve_point p;
+	if (bn_is_zero(k)) {
+		return 0;
+	}
+	point_multiply_ctx(ctx, curve, k, &curve->G, &p);
+	curve_to_jacobian(ctx, &p, jres, &curve->prime);
+	return 1;
+}
+
+void scalar_multiply_ctx(const crypto_ctx *ctx, const ecdsa_curve *curve, const bignum256 *k, curve_point *res)
+{
+	point_multiply_ctx(ctx, curve, k, &curve->G, res);
+}
+
+#endif
+
 void scalar_multiply(const ecdsa_curve *curve, const bignum256 *k, curve_point *res)
 {
-	point_multiply(curve, k, &curve->G, res);
+	scalar_multiply_ctx(0, curve, k, res);
+}
+
+// res = k * G + p
+// k must be a normalized number with 0 <= k < curve->order, p must be
+// a valid point other than infinity.  The addition is done in jacobian
+// coordinates, so only a single inversion is needed.
+void scalar_multiply_add(const ecdsa_curve *curve, const bignum256 *k, const curve_point *p, curve_point *res)
+{
+	scalar_multiply_add_ctx(0, curve, k, p, res);
+}
+
+void scalar_multiply_add_ctx(const crypto_ctx *ctx, const ecdsa_curve *curve, const bignum256 *k, const curve_point *p, curve_point *res)
+{
+	jacobian_curve_point jres;
+	bignum256 z;
+
+	if (!scalar_multiply_jacobian(ctx, curve, k, &jres)) {
+		point_copy(p, res);
+		return;
+	}
+	point_jacobian_add(p, &jres, curve);
+
+	// k * G = -p gives the point at infinity
+	z = jres.z;
+	bn_fast_mod(&z, &curve->prime);
+	bn_mod(&z, &curve->prime);
+	if (bn_is_zero(&z)) {
+		point_set_infinity(res);
+		return;
+	}
+	jacobian_to_curve(&jres, res, &curve->prime);
 }
 
+// jres = k1 * G + k2 * P
+// P is given by its table of odd multiples at `splits` evenly spaced
+// offsets, i.e.,
+//   ptable[t][i] = (2*i+1) * 2^(t*256/splits) * P
+// for t = 0..splits-1 and i = 0..7, where splits is 1, 2 or 4.
+// Both scalars are recoded in width-5 NAF.  A digit at position
+// t*256/splits + j is added from table t after j remaining doublings.
+// All additions are interleaved into a single chain of only
+// 256/splits Jacobian doublings (Shamir's trick, resp. a comb), so
+// the result needs only one conversion to affine coordinates.
+// The tables for G are rows of the precomputed table.
+// k1 and k2 must be normalized numbers with 0 <= k1, k2 < curve->order.
+// Returns 0 if both scalars are zero; jres is not set in that case.
+// This function is not constant time; only use it for public scalars,
+// e.g., for signature verification.
+int point_multiply_joint_table_jacobian(const ecdsa_curve *curve, const bignum256 *k1, const bignum256 *k2, const curve_point (*ptable)[8], int splits, jacobian_curve_point *jres)
+{
+	assert (bn_is_less(k1, &curve->order));
+	assert (bn_is_less(k2, &curve->order));
+	assert (splits == 1 || splits == 2 || splits == 4);
+
+	int j, t, pos;
+	int started = 0;
+	int step = 256 / splits;
+	int8_t naf[2][257];
+	int8_t digit;
+	curve_point p;
+	const curve_point *table[2][4];
+	const bignum256 *prime = &curve->prime;
+#if !USE_PRECOMPUTED_CP
+	int i;
+	curve_point gmult[4][8];
+#endif
+
+	bn_wnaf5(k1, naf[0]);
+	bn_wnaf5(k2, naf[1]);
+
+	for (t = 0; t < splits; t++) {
+#if USE_PRECOMPUTED_CP
+		// curve->cp[i][j] = (2*j+1) * 16^i * G
+		table[0][t] = curve->cp[t * step / 4];
+#else
+		if (t == 0) {
+			p = curve->G;
+		} else {
+			for (i = 0; i < step; i++) {
+				point_double(curve, &p);
+			}
+		}
+		point_odd_multiples(curve, &p, gmult[t]);
+		table[0][t] = gmult[t];
 #endif
+		table[1][t] = ptable[t];
+	}
+
+	// the digit at position 256 (if any) is handled by the last table
+	// as its offset step.
+	for (pos = step; pos >= 0; pos--) {
+		// invariant jres = sum_{digits with offset > pos}
+		//                  (naf[0][.] G_t + naf[1][.] P_t) 2^{offset-pos-1}
+		if (started) {
+			point_jacobian_double(jres, curve);
+		}
+		for (t = 0; t < splits; t++) {
+			if (pos == step && t < splits - 1) {
+				// this is offset 0 of table t+1
+				continue;
+			}
+			for (j = 0; j < 2; j++) {
+				digit = naf[j][t * step + pos];
+				if (digit == 0) {
+					continue;
+				}
+				p = table[j][t][(digit < 0 ? -digit : digit) >> 1];
+				if (digit < 0) {
+					// table entries are fully reduced, so -y = prime - y
+					bn_subtract(prime, &p.y, &p.y);
+				}
+				if (started) {
+					// Note: if p happens to be -jres, the result gets z = 0.
+					// This is absorbing, so the caller sees the point at
+					// infinity and rejects; for verification this can only
+					// turn a valid signature into a (negligibly unlikely)
+					// false negative.
+					point_jacobian_add(&p, jres, curve);
+				} else {
+					// the scalars are public, there is nothing to blind
+					jres->x = p.x;
+					jres->y = p.y;
+					bn_zero(&jres->z);
+					jres->z.val[0] = 1;
+					started = 1;
+				}
+			}
+		}
+	}
+
+	MEMSET_BZERO(naf, sizeof(naf));
+	return started;
+}
+
+// jres = k1 * G + k2 * p, see point_multiply_joint_table_jacobian.
+int point_multiply_joint_jacobian(const ecdsa_curve *curve, const bignum256 *k1, const bignum256 *k2, const curve_point *p, jacobian_curve_point *jres)
+{
+	curve_point pmult[1][8];
+
+	// pmult is not used if k2 is zero
+	if (!bn_is_zero(k2)) {
+		point_odd_multiples(curve, p, pmult[0]);
+	}
+	return point_multiply_joint_table_jacobian(curve, k1, k2, pmult, 1, jres);
+}
+
+// res = k1 * G + k2 * p
+// k1 and k2 must be normalized numbers with 0 <= k1, k2 < curve->order.
+// This function is not constant time; only use it for public scalars.
+void point_multiply_joint(const ecdsa_curve *curve, const bignum256 *k1, const bignum256 *k2, const curve_point *p, curve_point *res)
+{
+	jacobian_curve_point jres;
+
+	if (!point_multiply_joint_jacobian(curve, k1, k2, p, &jres)) {
+		point_set_infinity(res);
+		return;
+	}
+	bn_fast_mod(&jres.z, &curve->prime);
+	bn_mod(&jres.z, &curve->prime);
+	if (bn_is_zero(&jres.z)) {
+		point_set_infinity(res);
+		return;
+	}
+	jacobian_to_curve(&jres, res, &curve->prime);
+}
 
 // generate random K for signing
 int generate_k_random(const ecdsa_curve *curve, bignum256 *k) {
+	return generate_k_random_ctx(0, curve, k);
+}
+
+int generate_k_random_ctx(const crypto_ctx *ctx, const ecdsa_curve *curve, bignum256 *k) {
 	int i, j;
 	for (j = 0; j < 10000; j++) {
 		for (i = 0; i < 8; i++) {
-			k->val[i] = random32() & 0x3FFFFFFF;
+			k->val[i] = ctx_random32(ctx) & 0x3FFFFFFF;
 		}
-		k->val[8] = random32() & 0xFFFF;
+		k->val[8] = ctx_random32(ctx) & 0xFFFF;
 		// if k is too big or too small, we don't like it
 		if ( !bn_is_zero(k) && bn_is_less(k, &curve->order) ) {
 			return 0; // good number - no error
@@ -632,12 +1013,37 @@ int generate_k_random(const ecdsa_curve *curve, bignum256 *k) {
 	return 1;
 }
 
-// generate K in a deterministic way, according to RFC6979
+// K = HMAC(K, V || sep || data), then derive the midstates of the new K
+static void rfc6979_update_k(rfc6979_state *rng, uint8_t sep, const uint8_t *data, uint32_t len)
+{
+	int i;
+	uint8_t buf[32 + 1 + 2*32];
+
+	for (i = 0; i < 8; i++) {
+		write_be(buf + 4 * i, rng->v[i]);
+	}
+	buf[32] = sep;
+	if (len) {
+		memcpy(buf + 33, data, len);
+	}
+	hmac_sha256_finish(&rng->inner, &rng->outer, buf, 33 + len, buf);
+	hmac_sha256_prepare(buf, 32, &rng->inner, &rng->outer);
+	MEMSET_BZERO(buf, sizeof(buf));
+}
+
+// V = HMAC(K, V)
+static void rfc6979_update_v(rfc6979_state *rng)
+{
+	sha256_Compress(rng->inner.state, rng->v, rng->v);
+	sha256_Compress(rng->outer.state, rng->v, rng->v);
+}
+
+// initialize the HMAC-DRBG of RFC6979 (section 3.2, steps a. to g.)
 // http://tools.ietf.org/html/rfc6979
-int generate_k_rfc6979(const ecdsa_curve *curve, bignum256 *secret, const uint8_t *priv_key, const uint8_t *hash)
+void init_rfc6979(const ecdsa_curve *curve, const uint8_t *priv_key, const uint8_t *hash, rfc6979_state *rng)
 {
-	int i, error;
-	uint8_t v[32], k[32], bx[2*32], buf[32 + 1 + sizeof(bx)];
+	int i;
+	uint8_t k[32], bx[2*32];
 	bignum256 z1;
 
 	memcpy(bx, priv_key, 32);
@@ -645,40 +1051,68 @@ int generate_k_rfc6979(const ecdsa_curve *curve, bignum256 *secret, const uint8_
 	bn_mod(&z1, &curve->order);
 	bn_write_be(&z1, bx + 32);
 
-	memset(v, 1, sizeof(v));
+	// K = 0x00 0x00 ... 0x00, V = 0x01 0x01 ... 0x01
 	memset(k, 0, sizeof(k));
+	hmac_sha256_prepare(k, sizeof(k), &rng->inner, &rng->outer);
+	for (i = 0; i < 8; i++) {
+		rng->v[i] = 0x01010101;
+	}
+	rng->v[8] = 0x80000000;
+	for (i = 9; i < 15; i++) {
+		rng->v[i] = 0;
+	}
+	rng->v[15] = (SHA256_BLOCK_LENGTH + SHA256_DIGEST_LENGTH) * 8;
+	rng->drawn = 0;
+
+	rfc6979_update_k(rng, 0x00, bx, sizeof(bx));
+	rfc6979_update_v(rng);
+	rfc6979_update_k(rng, 0x01, bx, sizeof(bx));
+	rfc6979_update_v(rng);
+
+	MEMSET_BZERO(bx, sizeof(bx));
+	MEMSET_BZERO(&z1, sizeof(z1));
+}
+
+// next candidate for K (section 3.2, step h.); the state is only moved
+// on with K = HMAC(K, V || 0x00) once a candidate has been rejected
+void generate_rfc6979(uint8_t rnd[32], rfc6979_state *rng)
+{
+	int i;
 
-	memcpy(buf, v, sizeof(v));
-	buf[sizeof(v)] = 0x00;
-	memcpy(buf + sizeof(v) + 1, bx, 64);
-	hmac_sha256(k, sizeof(k), buf, sizeof(buf), k);
-	hmac_sha256(k, sizeof(k), v, sizeof(v), v);
+	if (rng->drawn) {
+		rfc6979_update_k(rng, 0x00, 0, 0);
+		rfc6979_update_v(rng);
+	}
+	rng->drawn = 1;
+	rfc6979_update_v(rng);
+	for (i = 0; i < 8; i++) {
+		write_be(rnd + 4 * i, rng->v[i]);
+	}
+}
+
+// generate K in a deterministic way, according to RFC6979
+// http://tools.ietf.org/html/rfc6979
+int generate_k_rfc6979(const ecdsa_curve *curve, bignum256 *secret, const uint8_t *priv_key, const uint8_t *hash)
+{
+	int i, error;
+	uint8_t v[32];
+	rfc6979_state rng;
 
-	memcpy(buf, v, sizeof(v));
-	buf[sizeof(v)] = 0x01;
-	memcpy(buf + sizeof(v) + 1, bx, 64);
-	hmac_sha256(k, sizeof(k), buf, sizeof(buf), k);
-	hmac_sha256(k, sizeof(k), v, sizeof(v), v);
+	init_rfc6979(curve, priv_key, hash, &rng);
 
 	error = 1;
 	for (i = 0; i < 10000; i++) {
-		hmac_sha256(k, sizeof(k), v, sizeof(v), v);
+		generate_rfc6979(v, &rng);
 		bn_read_be(v, secret);
 		if ( !bn_is_zero(secret) && bn_is_less(secret, &curve->order) ) {
 			error = 0; // good number -> no error
 			break;
 		}
-		memcpy(buf, v, sizeof(v));
-		buf[sizeof(v)] = 0x00;
-		hmac_sha256(k, sizeof(k), buf, sizeof(v) + 1, k);
-		hmac_sha256(k, sizeof(k), v, sizeof(v), v);
 	}
 	// we generated 10000 numbers, none of them is good -> fail
 
 	MEMSET_BZERO(v, sizeof(v));
-	MEMSET_BZERO(k, sizeof(k));
-	MEMSET_BZERO(bx, sizeof(bx));
-	MEMSET_BZERO(buf, sizeof(buf));
+	MEMSET_BZERO(&rng, sizeof(rng));
 	return error;
 }
 
@@ -699,8 +1133,7 @@ int ecdsa_sign(const ecdsa_curve *curve, const uint8_t *priv_key, const uint8_t
 int ecdsa_sign_double(const ecdsa_curve *curve, const uint8_t *priv_key, const uint8_t *msg, uint32_t msg_len, uint8_t *sig, uint8_t *pby)
 {
 	uint8_t hash[32];
-	sha256_Raw(msg, msg_len, hash);
-	sha256_Raw(hash, 32, hash);
+	sha256d_Raw(msg, msg_len, hash);
 	int res = ecdsa_sign_digest(curve, priv_key, hash, sig, pby);
 	MEMSET_BZERO(hash, sizeof(hash));
 	return res;
@@ -711,6 +1144,11 @@ int ecdsa_sign_double(const ecdsa_curve *curve, const uint8_t *priv_key, const u
 // sig is 64 bytes long array for the signature
 // digest is 32 bytes of digest
 int ecdsa_sign_digest(const ecdsa_curve *curve, const uint8_t *priv_key, const uint8_t *digest, uint8_t *sig, uint8_t *pby)
+{
+	return ecdsa_sign_digest_ctx(0, curve, priv_key, digest, sig, pby);
+}
+
+int ecdsa_sign_digest_ctx(const crypto_ctx *ctx, const ecdsa_curve *curve, const uint8_t *priv_key, const uint8_t *digest, uint8_t *sig, uint8_t *pby)
 {
 	uint32_t i;
 	curve_point R;
@@ -726,14 +1164,14 @@ int ecdsa_sign_digest(const ecdsa_curve *curve, const uint8_t *priv_key, const u
 	}
 #else
 	// generate random number k
-	if (generate_k_random(curve, &k) != 0) {
+	if (generate_k_random_ctx(ctx, curve, &k) != 0) {
 		result = 1;
 	}
 #endif
 
 	if (result == 0) {
 		// compute k*G
-		scalar_multiply(curve, &k, &R);
+		scalar_multiply_ctx(ctx, curve, &k, &R);
 		if (pby) {
 			*pby = R.y.val[0] & 1;
 		}
@@ -784,13 +1222,18 @@ int ecdsa_sign_digest(const ecdsa_curve *curve, const uint8_t *priv_key, const u
 }
 
 void ecdsa_get_public_key33(const ecdsa_curve *curve, const uint8_t *priv_key, uint8_t *pub_key)
+{
+	ecdsa_get_public_key33_ctx(0, curve, priv_key, pub_key);
+}
+
+void ecdsa_get_public_key33_ctx(const crypto_ctx *ctx, const ecdsa_curve *curve, const uint8_t *priv_key, uint8_t *pub_key)
 {
 	curve_point R;
 	bignum256 k;
 
 	bn_read_be(priv_key, &k);
 	// compute k*G
-	scalar_multiply(curve, &k, &R);
+	scalar_multiply_ctx(ctx, curve, &k, &R);
 	pub_key[0] = 0x02 | (R.y.val[0] & 0x01);
 	bn_write_be(&R.x, pub_key + 1);
 	MEMSET_BZERO(&R, sizeof(R));
@@ -798,13 +1241,18 @@ void ecdsa_get_public_key33(const ecdsa_curve *curve, const uint8_t *priv_key, u
 }
 
 void ecdsa_get_public_key65(const ecdsa_curve *curve, const uint8_t *priv_key, uint8_t *pub_key)
+{
+	ecdsa_get_public_key65_ctx(0, curve, priv_key, pub_key);
+}
+
+void ecdsa_get_public_key65_ctx(const crypto_ctx *ctx, const ecdsa_curve *curve, const uint8_t *priv_key, uint8_t *pub_key)
 {
 	curve_point R;
 	bignum256 k;
 
 	bn_read_be(priv_key, &k);
 	// compute k*G
-	scalar_multiply(curve, &k, &R);
+	scalar_multiply_ctx(ctx, curve, &k, &R);
 	pub_key[0] = 0x04;
 	bn_write_be(&R.x, pub_key + 1);
 	bn_write_be(&R.y, pub_key + 33);
@@ -814,16 +1262,13 @@ void ecdsa_get_public_key65(const ecdsa_curve *curve, const uint8_t *priv_key, u
 
 void ecdsa_get_pubkeyhash(const uint8_t *pub_key, uint8_t *pubkeyhash)
 {
-	uint8_t h[32];
 	if (pub_key[0] == 0x04) {  // uncompressed format
-		sha256_Raw(pub_key, 65, h);
+		hash160(pub_key, 65, pubkeyhash);
 	} else if (pub_key[0] == 0x00) { // point at infinity
-		sha256_Raw(pub_key, 1, h);
+		hash160(pub_key, 1, pubkeyhash);
 	} else {
-		sha256_Raw(pub_key, 33, h); // expecting compressed format
+		hash160(pub_key, 33, pubkeyhash); // expecting compressed format
 	}
-	ripemd160(h, 32, pubkeyhash);
-	MEMSET_BZERO(h, sizeof(h));
 }
 
 void ecdsa_get_address_raw(const uint8_t *pub_key, uint8_t version, uint8_t *addr_raw)
@@ -946,68 +1391,249 @@ int ecdsa_verify(const ecdsa_curve *curve, const uint8_t *pub_key, const uint8_t
 int ecdsa_verify_double(const ecdsa_curve *curve, const uint8_t *pub_key, const uint8_t *sig, const uint8_t *msg, uint32_t msg_len)
 {
 	uint8_t hash[32];
-	sha256_Raw(msg, msg_len, hash);
-	sha256_Raw(hash, 32, hash);
+	sha256d_Raw(msg, msg_len, hash);
 	int res = ecdsa_verify_digest(curve, pub_key, sig, hash);
 	MEMSET_BZERO(hash, sizeof(hash));
 	return res;
 }
 
-// returns 0 if verification succeeded
-int ecdsa_verify_digest(const ecdsa_curve *curve, const uint8_t *pub_key, const uint8_t *sig, const uint8_t *digest)
+// checks whether x(R) = r (mod order) for a point R given in Jacobian
+// coordinates as (X/Z^2, Y/Z^3).  Instead of converting R to affine
+// coordinates we check  X == r * Z^2  or  X == (r + order) * Z^2
+// (if r + order < prime), which saves the inversion of Z.
+// r must be fully reduced modulo order.
+// returns 1 if the check succeeds, 0 otherwise.
+int ecdsa_jacobian_x_equals_r(const ecdsa_curve *curve, const jacobian_curve_point *jp, const bignum256 *r)
 {
-	curve_point pub, res;
-	bignum256 r, s, z;
+	bignum256 x, zz, rz;
+	const bignum256 *prime = &curve->prime;
+	int result = 0;
 
-	if (!ecdsa_read_pubkey(curve, pub_key, &pub)) {
-		return 1;
+	zz = jp->z;
+	bn_fast_mod(&zz, prime);
+	bn_mod(&zz, prime);
+	if (bn_is_zero(&zz)) {
+		// R is the point at infinity
+		return 0;
+	}
+	bn_multiply(&jp->z, &zz, prime); // Z^2
+	x = jp->x;
+	bn_fast_mod(&x, prime);
+	bn_mod(&x, prime);
+
+	rz = *r;
+	bn_multiply(&zz, &rz, prime);
+	bn_mod(&rz, prime);
+	if (bn_is_equal(&rz, &x)) {
+		result = 1;
+	} else {
+		rz = *r;
+		bn_add(&rz, &curve->order);
+		if (bn_is_less(&rz, prime)) {
+			bn_multiply(&zz, &rz, prime);
+			bn_mod(&rz, prime);
+			result = bn_is_equal(&rz, &x);
+		}
 	}
 
-	bn_read_be(sig, &r);
-	bn_read_be(sig + 32, &s);
+	MEMSET_BZERO(&x, sizeof(x));
+	MEMSET_BZERO(&zz, sizeof(zz));
+	MEMSET_BZERO(&rz, sizeof(rz));
+	return result;
+}
 
-	bn_read_be(digest, &z);
+// common implementation of the batch verification.
+// The public keys are given either as pub_keys or as pub_tables,
+// the other argument must be 0.
+int ecdsa_verify_batch(const ecdsa_curve *curve, const uint8_t * const *pub_keys, const ecdsa_pubkey_table * const *pub_tables, const uint8_t * const *sigs, const uint8_t *digest, int n)
+{
+	curve_point pub[ECDSA_VERIFY_BATCH_MAX];
+	curve_point pmult[1][8];
+	jacobian_curve_point jres;
+	bignum256 r[ECDSA_VERIFY_BATCH_MAX], s[ECDSA_VERIFY_BATCH_MAX];
+	bignum256 prod[ECDSA_VERIFY_BATCH_MAX];
+	bignum256 inv, u1, u2;
+	int i, result = 0;
 
-	if (bn_is_zero(&r) || bn_is_zero(&s) ||
-		(!bn_is_less(&r, &curve->order)) ||
-		(!bn_is_less(&s, &curve->order))) return 2;
+	if (n < 1 || n > ECDSA_VERIFY_BATCH_MAX) {
+		return 1;
+	}
 
-	bn_inverse(&s, &curve->order); // s^-1
-	bn_multiply(&s, &z, &curve->order); // z*s^-1
-	bn_mod(&z, &curve->order);
-	bn_multiply(&r, &s, &curve->order); // r*s^-1
-	bn_mod(&s, &curve->order);
+	// the inversion below only runs once every s[i] has been read;
+	// clear them anyway so the compiler can see they are set
+	MEMSET_BZERO(r, sizeof(r));
+	MEMSET_BZERO(s, sizeof(s));
 
-	int result = 0;
-	if (bn_is_zero(&z)) {
-		// our message hashes to zero
-		// I don't expect this to happen any time soon
-		result = 3;
-	} else {
-		scalar_multiply(curve, &z, &res);
+	for (i = 0; i < n; i++) {
+		if (pub_keys && !ecdsa_read_pubkey(curve, pub_keys[i], &pub[i])) {
+			result = 1;
+			break;
+		}
+
+		bn_read_be(sigs[i], &r[i]);
+		bn_read_be(sigs[i] + 32, &s[i]);
+
+		if (bn_is_zero(&r[i]) || bn_is_zero(&s[i]) ||
+			(!bn_is_less(&r[i], &curve->order)) ||
+			(!bn_is_less(&s[i], &curve->order))) {
+			result = 2;
+			break;
+		}
 	}
 
 	if (result == 0) {
-		// both pub and res can be infinity, can have y = 0 OR can be equal -> false negative
-		point_multiply(curve, &s, &pub, &pub);
-		point_add(curve, &pub, &res);
-		bn_mod(&(res.x), &curve->order);
+		// prod[i] = s[0] * ... * s[i]
+		prod[0] = s[0];
+		for (i = 1; i < n; i++) {
+			prod[i] = s[i];
+			bn_multiply(&prod[i - 1], &prod[i], &curve->order);
+		}
+		inv = prod[n - 1];
+		bn_inverse(&inv, &curve->order);
+		// invariant: inv = (s[0] * ... * s[i])^-1
+		for (i = n - 1; i > 0; i--) {
+			// s[i]^-1 = inv * s[0] * ... * s[i-1]
+			bn_multiply(&inv, &prod[i - 1], &curve->order);
+			bn_multiply(&s[i], &inv, &curve->order);
+			s[i] = prod[i - 1];
+			bn_mod(&s[i], &curve->order);
+		}
+		s[0] = inv;
+		bn_mod(&s[0], &curve->order);
+	}
+
+	for (i = 0; i < n && result == 0; i++) {
+		bn_read_be(digest, &u1);
+		bn_multiply(&s[i], &u1, &curve->order); // z*s^-1
+		bn_mod(&u1, &curve->order);
+		u2 = r[i];
+		bn_multiply(&s[i], &u2, &curve->order); // r*s^-1
+		bn_mod(&u2, &curve->order);
+
+		if (bn_is_zero(&u1)) {
+			// our message hashes to zero
+			// I don't expect this to happen any time soon
+			result = 3;
+			break;
+		}
+
+		// R = z*s^-1 * G + r*s^-1 * pub
+		if (pub_tables) {
+			if (!point_multiply_joint_table_jacobian(curve, &u1, &u2, pub_tables[i]->p, 4, &jres)) {
+				result = 5;
+			}
+		} else {
+			point_odd_multiples(curve, &pub[i], pmult[0]);
+			if (!point_multiply_joint_table_jacobian(curve, &u1, &u2, pmult, 1, &jres)) {
+				result = 5;
+			}
+		}
+
 		// signature does not match
-		if (!bn_is_equal(&res.x, &r)) {
+		if (result == 0 && !ecdsa_jacobian_x_equals_r(curve, &jres, &r[i])) {
 			result = 5;
 		}
 	}
 
-	MEMSET_BZERO(&pub, sizeof(pub));
-	MEMSET_BZERO(&res, sizeof(res));
+	MEMSET_BZERO(pub, sizeof(pub));
+	MEMSET_BZERO(pmult, sizeof(pmult));
+	MEMSET_BZERO(&jres, sizeof(jres));
+	MEMSET_BZERO(r, sizeof(r));
+	MEMSET_BZERO(s, sizeof(s));
+	MEMSET_BZERO(prod, sizeof(prod));
+	MEMSET_BZERO(&inv, sizeof(inv));
+	MEMSET_BZERO(&u1, sizeof(u1));
+	MEMSET_BZERO(&u2, sizeof(u2));
+
+	return result;
+}
+
+// returns 0 if verification succeeded
+int ecdsa_verify_digest(const ecdsa_curve *curve, const uint8_t *pub_key, const uint8_t *sig, const uint8_t *digest)
+{
+	return ecdsa_verify_digest_batch(curve, &pub_key, &sig, digest, 1);
+}
+
+// recover the public key that made the signature sig of digest
+// recid is the recovery id, i.e., bit 0 is the parity of R.y and bit 1
+// is set if R.x = r + order.
+// pub_key is set to the 65 byte uncompressed key.  Any key recovered
+// this way verifies the signature, so there is no need to check it
+// with ecdsa_verify_digest again.
+// returns 0 if a key was recovered
+int ecdsa_recover_pub_from_sig(const ecdsa_curve *curve, uint8_t *pub_key, const uint8_t *sig, const uint8_t *digest, int recid)
+{
+	bignum256 r, s, e;
+	curve_point cp;
+	int result = 0;
+
+	bn_read_be(sig, &r);
+	bn_read_be(sig + 32, &s);
+	if (bn_is_zero(&r) || bn_is_zero(&s) ||
+		(!bn_is_less(&r, &curve->order)) ||
+		(!bn_is_less(&s, &curve->order))) {
+		return 1;
+	}
+
+	// cp = R, the point with R.x = r (+ order)
+	cp.x = r;
+	if (recid & 2) {
+		bn_add(&cp.x, &curve->order);
+		if (!bn_is_less(&cp.x, &curve->prime)) {
+			return 1;
+		}
+	}
+	uncompress_coords(curve, recid & 1, &cp.x, &cp.y);
+	if (!ecdsa_validate_pubkey(curve, &cp)) {
+		return 1;
+	}
+
+	// pub = r^-1 * (s * R - z * G) = (-z * r^-1) * G + (s * r^-1) * R
+	bn_read_be(digest, &e);
+	bn_mod(&e, &curve->order);
+	bn_subtract(&curve->order, &e, &e);
+	bn_mod(&e, &curve->order);
+	bn_inverse(&r, &curve->order);
+	bn_multiply(&r, &e, &curve->order);
+	bn_mod(&e, &curve->order);
+	bn_multiply(&r, &s, &curve->order);
+	bn_mod(&s, &curve->order);
+	point_multiply_joint(curve, &e, &s, &cp, &cp);
+	if (point_is_infinity(&cp)) {
+		result = 2;
+	} else {
+		pub_key[0] = 0x04;
+		bn_write_be(&cp.x, pub_key + 1);
+		bn_write_be(&cp.y, pub_key + 33);
+	}
+
 	MEMSET_BZERO(&r, sizeof(r));
 	MEMSET_BZERO(&s, sizeof(s));
-	MEMSET_BZERO(&z, sizeof(z));
-
-	// all OK
+	MEMSET_BZERO(&e, sizeof(e));
+	MEMSET_BZERO(&cp, sizeof(cp));
 	return result;
 }
 
+// verifies that sigs[i] is a valid signature of digest by pub_keys[i]
+// for all 0 <= i < n, where 1 <= n <= ECDSA_VERIFY_BATCH_MAX.
+// The inversions of all s values are shared using Montgomery's trick,
+// i.e., n signatures cost a single bn_inverse.
+// returns 0 if all signatures are valid, otherwise the error code
+// of the first failing signature (see ecdsa_verify_digest).
+int ecdsa_verify_digest_batch(const ecdsa_curve *curve, const uint8_t * const *pub_keys, const uint8_t * const *sigs, const uint8_t *digest, int n)
+{
+	return ecdsa_verify_batch(curve, pub_keys, 0, sigs, digest, n);
+}
+
+// same as ecdsa_verify_digest_batch, but the public keys are given by
+// their precomputed tables, which must be valid points on the curve.
+// This saves reading the public keys and computing their odd multiples,
+// and the comb reduces the number of doublings to 64.
+int ecdsa_verify_digest_batch_table(const ecdsa_curve *curve, const ecdsa_pubkey_table * const *pub_tables, const uint8_t * const *sigs, const uint8_t *digest, int n)
+{
+	return ecdsa_verify_batch(curve, 0, pub_tables, sigs, digest, n);
+}
+
 int ecdsa_sig_to_der(const uint8_t *sig, uint8_t *der)
 {
 	int i;
@@ -27,11 +27,10 @@
 #include "sha2.h"
 #include "macros.h"
 
-void hmac_sha256(const uint8_t *key, const uint32_t keylen, const uint8_t *msg, const uint32_t msglen, uint8_t *hmac)
+void hmac_sha256_prepare(const uint8_t *key, const uint32_t keylen, SHA256_CTX *inner, SHA256_CTX *outer)
 {
 	int i;
-	uint8_t buf[SHA256_BLOCK_LENGTH], o_key_pad[SHA256_BLOCK_LENGTH], i_key_pad[SHA256_BLOCK_LENGTH];
-	SHA256_CTX ctx;
+	uint8_t buf[SHA256_BLOCK_LENGTH], key_pad[SHA256_BLOCK_LENGTH];
 
 	memset(buf, 0, SHA256_BLOCK_LENGTH);
 	if (keylen > SHA256_BLOCK_LENGTH) {
@@ -41,29 +40,51 @@ void hmac_sha256(const uint8_t *key, const uint32_t keylen, const uint8_t *msg,
 	}
 
 	for (i = 0; i < SHA256_BLOCK_LENGTH; i++) {
-		o_key_pad[i] = buf[i] ^ 0x5c;
-		i_key_pad[i] = buf[i] ^ 0x36;
+		key_pad[i] = buf[i] ^ 0x36;
+	}
+	sha256_Init(inner);
+	sha256_Update(inner, key_pad, SHA256_BLOCK_LENGTH);
+
+	for (i = 0; i < SHA256_BLOCK_LENGTH; i++) {
+		key_pad[i] = buf[i] ^ 0x5c;
 	}
+	sha256_Init(outer);
+	sha256_Update(outer, key_pad, SHA256_BLOCK_LENGTH);
 
-	sha256_Init(&ctx);
-	sha256_Update(&ctx, i_key_pad, SHA256_BLOCK_LENGTH);
+	MEMSET_BZERO(buf, sizeof(buf));
+	MEMSET_BZERO(key_pad, sizeof(key_pad));
+}
+
+void hmac_sha256_finish(const SHA256_CTX *inner, const SHA256_CTX *outer, const uint8_t *msg, const uint32_t msglen, uint8_t *hmac)
+{
+	uint8_t buf[SHA256_DIGEST_LENGTH];
+	SHA256_CTX ctx;
+
+	ctx = *inner;
 	sha256_Update(&ctx, msg, msglen);
 	sha256_Final(buf, &ctx);
 
-	sha256_Init(&ctx);
-	sha256_Update(&ctx, o_key_pad, SHA256_BLOCK_LENGTH);
+	ctx = *outer;
 	sha256_Update(&ctx, buf, SHA256_DIGEST_LENGTH);
 	sha256_Final(hmac, &ctx);
+
 	MEMSET_BZERO(buf, sizeof(buf));
-	MEMSET_BZERO(o_key_pad, sizeof(o_key_pad));
-	MEMSET_BZERO(i_key_pad, sizeof(i_key_pad));
 }
 
-void hmac_sha512(const uint8_t *key, const uint32_t keylen, const uint8_t *msg, const uint32_t msglen, uint8_t *hmac)
+void hmac_sha256(const uint8_t *key, const uint32_t keylen, const uint8_t *msg, const uint32_t msglen, uint8_t *hmac)
+{
+	SHA256_CTX inner, outer;
+
+	hmac_sha256_prepare(key, keylen, &inner, &outer);
+	hmac_sha256_finish(&inner, &outer, msg, msglen, hmac);
+	MEMSET_BZERO(&inner, sizeof(inner));
+	MEMSET_BZERO(&outer, sizeof(outer));
+}
+
+void hmac_sha512_prepare(const uint8_t *key, const uint32_t keylen, SHA512_CTX *inner, SHA512_CTX *outer)
 {
 	int i;
-	uint8_t buf[SHA512_BLOCK_LENGTH], o_key_pad[SHA512_BLOCK_LENGTH], i_key_pad[SHA512_BLOCK_LENGTH];
-	SHA512_CTX ctx;
+	uint8_t buf[SHA512_BLOCK_LENGTH], key_pad[SHA512_BLOCK_LENGTH];
 
 	memset(buf, 0, SHA512_BLOCK_LENGTH);
 	if (keylen > SHA512_BLOCK_LENGTH) {
@@ -73,21 +94,43 @@ void hmac_sha512(const uint8_t *key, const uint32_t keylen, const uint8_t *msg,
 	}
 
 	for (i = 0; i < SHA512_BLOCK_LENGTH; i++) {
-		o_key_pad[i] = buf[i] ^ 0x5c;
-		i_key_pad[i] = buf[i] ^ 0x36;
+		key_pad[i] = buf[i] ^ 0x36;
+	}
+	sha512_Init(inner);
+	sha512_Update(inner, key_pad, SHA512_BLOCK_LENGTH);
+
+	for (i = 0; i < SHA512_BLOCK_LENGTH; i++) {
+		key_pad[i] = buf[i] ^ 0x5c;
 	}
+	sha512_Init(outer);
+	sha512_Update(outer, key_pad, SHA512_BLOCK_LENGTH);
+
+	MEMSET_BZERO(buf, sizeof(buf));
+	MEMSET_BZERO(key_pad, sizeof(key_pad));
+}
 
-	sha512_Init(&ctx);
-	sha512_Update(&ctx, i_key_pad, SHA512_BLOCK_LENGTH);
+void hmac_sha512_finish(const SHA512_CTX *inner, const SHA512_CTX *outer, const uint8_t *msg, const uint32_t msglen, uint8_t *hmac)
+{
+	uint8_t buf[SHA512_DIGEST_LENGTH];
+	SHA512_CTX ctx;
+
+	ctx = *inner;
 	sha512_Update(&ctx, msg, msglen);
 	sha512_Final(buf, &ctx);
 
-	sha512_Init(&ctx);
-	sha512_Update(&ctx, o_key_pad, SHA512_BLOCK_LENGTH);
+	ctx = *outer;
 	sha512_Update(&ctx, buf, SHA512_DIGEST_LENGTH);
 	sha512_Final(hmac, &ctx);
 
 	MEMSET_BZERO(buf, sizeof(buf));
-	MEMSET_BZERO(o_key_pad, sizeof(o_key_pad));
-	MEMSET_BZERO(i_key_pad, sizeof(i_key_pad));
+}
+
+void hmac_sha512(const uint8_t *key, const uint32_t keylen, const uint8_t *msg, const uint32_t msglen, uint8_t *hmac)
+{
+	SHA512_CTX inner, outer;
+
+	hmac_sha512_prepare(key, keylen, &inner, &outer);
+	hmac_sha512_finish(&inner, &outer, msg, msglen, hmac);
+	MEMSET_BZERO(&inner, sizeof(inner));
+	MEMSET_BZERO(&outer, sizeof(outer));
 }
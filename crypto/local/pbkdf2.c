@@ -30,68 +30,118 @@ void pbkdf2_hmac_sha256(const uint8_t *pass, int passlen, uint8_t *salt, int sal
 {
 	const uint32_t HMACLEN = 256/8;
 	uint32_t i, j, k;
-	uint8_t f[HMACLEN], g[HMACLEN];
+	uint8_t g[HMACLEN];
+	uint32_t f[8], block[16];
+	SHA256_CTX inner, outer;
 	uint32_t blocks = keylen / HMACLEN;
 	if (keylen & (HMACLEN - 1)) {
 		blocks++;
 	}
+	// the password is the HMAC key in every round, hash it only once
+	hmac_sha256_prepare(pass, passlen, &inner, &outer);
+	// after the first round, both the inner and the outer hash compress
+	// a single block: the previous digest followed by fixed padding.
+	block[8] = 0x80000000;
+	for (k = 9; k < 15; k++) {
+		block[k] = 0;
+	}
+	block[15] = (SHA256_BLOCK_LENGTH + HMACLEN) * 8;
 	for (i = 1; i <= blocks; i++) {
 		salt[saltlen    ] = (i >> 24) & 0xFF;
 		salt[saltlen + 1] = (i >> 16) & 0xFF;
 		salt[saltlen + 2] = (i >> 8) & 0xFF;
 		salt[saltlen + 3] = i & 0xFF;
-		hmac_sha256(pass, passlen, salt, saltlen + 4, g);
-		memcpy(f, g, HMACLEN);
+		hmac_sha256_finish(&inner, &outer, salt, saltlen + 4, g);
+		for (k = 0; k < 8; k++) {
+			block[k] = ((uint32_t)g[4 * k] << 24) | ((uint32_t)g[4 * k + 1] << 16) | ((uint32_t)g[4 * k + 2] << 8) | g[4 * k + 3];
+			f[k] = block[k];
+		}
 		for (j = 1; j < iterations; j++) {
-			hmac_sha256(pass, passlen, g, HMACLEN, g);
-			for (k = 0; k < HMACLEN; k++) {
-				f[k] ^= g[k];
+			sha256_Compress(inner.state, block, block);
+			sha256_Compress(outer.state, block, block);
+			for (k = 0; k < 8; k++) {
+				f[k] ^= block[k];
 			}
 			if (progress_callback) {
 				progress_callback(j + 1, iterations);
 			}
 		}
+		for (k = 0; k < 8; k++) {
+			g[4 * k] = f[k] >> 24;
+			g[4 * k + 1] = f[k] >> 16;
+			g[4 * k + 2] = f[k] >> 8;
+			g[4 * k + 3] = f[k];
+		}
 		if (i == blocks && (keylen & (HMACLEN - 1))) {
-			memcpy(key + HMACLEN * (i - 1), f, keylen & (HMACLEN - 1));
+			memcpy(key + HMACLEN * (i - 1), g, keylen & (HMACLEN - 1));
 		} else {
-			memcpy(key + HMACLEN * (i - 1), f, HMACLEN);
+			memcpy(key + HMACLEN * (i - 1), g, HMACLEN);
 		}
 	}
 	MEMSET_BZERO(f, sizeof(f));
 	MEMSET_BZERO(g, sizeof(g));
+	MEMSET_BZERO(block, sizeof(block));
+	MEMSET_BZERO(&inner, sizeof(inner));
+	MEMSET_BZERO(&outer, sizeof(outer));
 }
 
 void pbkdf2_hmac_sha512(const uint8_t *pass, int passlen, uint8_t *salt, int saltlen, uint32_t iterations, uint8_t *key, int keylen, void (*progress_callback)(uint32_t current, uint32_t total))
 {
 	const uint32_t HMACLEN = 512/8;
-	uint32_t i, j, k;
-	uint8_t f[HMACLEN], g[HMACLEN];
+	uint32_t i, j, k, l;
+	uint8_t g[HMACLEN];
+	uint64_t f[8], block[16];
+	SHA512_CTX inner, outer;
 	uint32_t blocks = keylen / HMACLEN;
 	if (keylen & (HMACLEN - 1)) {
 		blocks++;
 	}
+	// the password is the HMAC key in every round, hash it only once
+	hmac_sha512_prepare(pass, passlen, &inner, &outer);
+	// after the first round, both the inner and the outer hash compress
+	// a single block: the previous digest followed by fixed padding.
+	block[8] = 0x8000000000000000ULL;
+	for (k = 9; k < 15; k++) {
+		block[k] = 0;
+	}
+	block[15] = (SHA512_BLOCK_LENGTH + HMACLEN) * 8;
 	for (i = 1; i <= blocks; i++) {
 		salt[saltlen    ] = (i >> 24) & 0xFF;
 		salt[saltlen + 1] = (i >> 16) & 0xFF;
 		salt[saltlen + 2] = (i >> 8) & 0xFF;
 		salt[saltlen + 3] = i & 0xFF;
-		hmac_sha512(pass, passlen, salt, saltlen + 4, g);
-		memcpy(f, g, HMACLEN);
+		hmac_sha512_finish(&inner, &outer, salt, saltlen + 4, g);
+		for (k = 0; k < 8; k++) {
+			block[k] = 0;
+			for (l = 0; l < 8; l++) {
+				block[k] = (block[k] << 8) | g[8 * k + l];
+			}
+			f[k] = block[k];
+		}
 		for (j = 1; j < iterations; j++) {
-			hmac_sha512(pass, passlen, g, HMACLEN, g);
-			for (k = 0; k < HMACLEN; k++) {
-				f[k] ^= g[k];
+			sha512_Compress(inner.state, block, block);
+			sha512_Compress(outer.state, block, block);
+			for (k = 0; k < 8; k++) {
+				f[k] ^= block[k];
 			}
 			if (progress_callback) {
 				progress_callback(j + 1, iterations);
 			}
 		}
+		for (k = 0; k < 8; k++) {
+			for (l = 0; l < 8; l++) {
+				g[8 * k + l] = f[k] >> (56 - 8 * l);
+			}
+		}
 		if (i == blocks && (keylen & (HMACLEN - 1))) {
-			memcpy(key + HMACLEN * (i - 1), f, keylen & (HMACLEN - 1));
+			memcpy(key + HMACLEN * (i - 1), g, keylen & (HMACLEN - 1));
 		} else {
-			memcpy(key + HMACLEN * (i - 1), f, HMACLEN);
+			memcpy(key + HMACLEN * (i - 1), g, HMACLEN);
 		}
 	}
 	MEMSET_BZERO(f, sizeof(f));
 	MEMSET_BZERO(g, sizeof(g));
+	MEMSET_BZERO(block, sizeof(block));
+	MEMSET_BZERO(&inner, sizeof(inner));
+	MEMSET_BZERO(&outer, sizeof(outer));
 }
@@ -1,6 +1,7 @@
 #include <string.h>
 
 #include "ripemd160.h"
+#include "sha2.h"
 
 #define ROL(x, n)	(((x) << (n)) | ((x) >> (32-(n))))
 
@@ -301,3 +302,32 @@ void ripemd160(const uint8_t *msg, uint32_t msg_len, uint8_t *hash)
 		*(hash++) = digest[i] >> 24;
 	}
 }
+
+// RIPEMD-160 of the SHA-256 of msg.  The 32-byte SHA-256 digest always
+// fits into one RIPEMD-160 block with fixed padding, so the second pass
+// is a single compression.
+void hash160(const uint8_t *msg, uint32_t msg_len, uint8_t *hash)
+{
+	uint8_t h[SHA256_DIGEST_LENGTH];
+	uint32_t chunk[16] = {0};
+	uint32_t digest[5] = {0x67452301, 0xefcdab89, 0x98badcfe, 0x10325476, 0xc3d2e1f0UL};
+	int i;
+
+	sha256_Raw(msg, msg_len, h);
+	for (i = 0; i < 8; ++i) {
+		chunk[i] = (uint32_t)h[4 * i] | ((uint32_t)h[4 * i + 1] << 8) |
+		           ((uint32_t)h[4 * i + 2] << 16) | ((uint32_t)h[4 * i + 3] << 24);
+	}
+	chunk[8] = 0x80;
+	chunk[14] = SHA256_DIGEST_LENGTH << 3;
+	compress (digest, chunk);
+
+	for (i = 0; i < 5; ++i) {
+		*(hash++) = digest[i];
+		*(hash++) = digest[i] >> 8;
+		*(hash++) = digest[i] >> 16;
+		*(hash++) = digest[i] >> 24;
+	}
+	memset(h, 0, sizeof(h));
+	memset(chunk, 0, sizeof(chunk));
+}
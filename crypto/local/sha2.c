@@ -460,6 +460,75 @@ void sha256_Transform(SHA256_CTX* context, const sha2_word32* data) {
 
 #endif /* SHA2_UNROLL_TRANSFORM */
 
+/*
+ * Compress one block given as 16 words in host byte order, starting
+ * from the chaining value state_in.  This skips the buffering and
+ * byte order conversions of sha256_Update and sha256_Final, so it
+ * can be used with pre-laid-out padding to hash short messages of a
+ * fixed length from a midstate.  state_out may be equal to state_in.
+ */
+void sha256_Compress(const sha2_word32* state_in, const sha2_word32* data, sha2_word32* state_out) {
+	sha2_word32	a, b, c, d, e, f, g, h, s0, s1;
+	sha2_word32	T1, T2, W256[16];
+	int		j;
+
+	a = state_in[0];
+	b = state_in[1];
+	c = state_in[2];
+	d = state_in[3];
+	e = state_in[4];
+	f = state_in[5];
+	g = state_in[6];
+	h = state_in[7];
+
+	j = 0;
+	do {
+		T1 = h + Sigma1_256(e) + Ch(e, f, g) + K256[j] + (W256[j] = data[j]);
+		T2 = Sigma0_256(a) + Maj(a, b, c);
+		h = g;
+		g = f;
+		f = e;
+		e = d + T1;
+		d = c;
+		c = b;
+		b = a;
+		a = T1 + T2;
+
+		j++;
+	} while (j < 16);
+
+	do {
+		s0 = sigma0_256(W256[(j+1)&0x0f]);
+		s1 = sigma1_256(W256[(j+14)&0x0f]);
+		T1 = h + Sigma1_256(e) + Ch(e, f, g) + K256[j] +
+		     (W256[j&0x0f] += s1 + W256[(j+9)&0x0f] + s0);
+		T2 = Sigma0_256(a) + Maj(a, b, c);
+		h = g;
+		g = f;
+		f = e;
+		e = d + T1;
+		d = c;
+		c = b;
+		b = a;
+		a = T1 + T2;
+
+		j++;
+	} while (j < 64);
+
+	state_out[0] = state_in[0] + a;
+	state_out[1] = state_in[1] + b;
+	state_out[2] = state_in[2] + c;
+	state_out[3] = state_in[3] + d;
+	state_out[4] = state_in[4] + e;
+	state_out[5] = state_in[5] + f;
+	state_out[6] = state_in[6] + g;
+	state_out[7] = state_in[7] + h;
+
+	/* Clean up */
+	a = b = c = d = e = f = g = h = T1 = T2 = 0;
+	MEMSET_BZERO(W256, sizeof(W256));
+}
+
 void sha256_Update(SHA256_CTX* context, const sha2_byte *data, size_t len) {
 	unsigned int	freespace, usedspace;
 
@@ -505,6 +574,27 @@ void sha256_Update(SHA256_CTX* context, const sha2_byte *data, size_t len) {
 	usedspace = freespace = 0;
 }
 
+/*
+ * Same as sha256_Update with the bytes of data in reverse order, but
+ * without reversing into a temporary copy first.  Transaction ids are
+ * displayed in the reverse of the byte order in which they are hashed.
+ */
+void sha256_UpdateReversed(SHA256_CTX* context, const sha2_byte *data, size_t len) {
+	unsigned int	usedspace;
+
+	usedspace = (context->bitcount >> 3) % SHA256_BLOCK_LENGTH;
+	context->bitcount += (sha2_word64)len << 3;
+	while (len > 0) {
+		context->buffer[usedspace++] = data[--len];
+		if (usedspace == SHA256_BLOCK_LENGTH) {
+			sha256_Transform(context, (sha2_word32*)context->buffer);
+			usedspace = 0;
+		}
+	}
+	/* Clean up: */
+	usedspace = 0;
+}
+
 void sha256_Final(sha2_byte digest[], SHA256_CTX* context) {
 	sha2_word32	*d = (sha2_word32*)digest;
 	unsigned int	usedspace;
@@ -541,8 +631,7 @@ void sha256_Final(sha2_byte digest[], SHA256_CTX* context) {
 			*context->buffer = 0x80;
 		}
 		/* Set the bit count: */
-		sha2_word64 *t = (sha2_word64 *)&context->buffer[SHA256_SHORT_BLOCK_LENGTH];
-		*t = context->bitcount;
+		MEMCPY_BCOPY(&context->buffer[SHA256_SHORT_BLOCK_LENGTH], &context->bitcount, sizeof(context->bitcount));
 
 		/* Final transform: */
 		sha256_Transform(context, (sha2_word32*)context->buffer);
@@ -601,6 +690,45 @@ char* sha256_Data(const sha2_byte* data, size_t len, char digest[SHA256_DIGEST_S
 	return sha256_End(&context, digest);
 }
 
+/*
+ * Double SHA-256.  The second pass always hashes a single 32-byte
+ * digest, so its padding is fixed and it is one sha256_Compress from
+ * the initial hash value instead of another Init/Update/Final.
+ */
+void sha256d_Final(sha2_byte digest[], SHA256_CTX* context) {
+	sha2_word32	block[16], state[8];
+	int		j;
+
+	sha256_Final(digest, context);
+	for (j = 0; j < 8; j++) {
+		block[j] = ((sha2_word32)digest[4 * j] << 24) | ((sha2_word32)digest[4 * j + 1] << 16) |
+		           ((sha2_word32)digest[4 * j + 2] << 8) | digest[4 * j + 3];
+	}
+	block[8] = 0x80000000;
+	for (j = 9; j < 15; j++) {
+		block[j] = 0;
+	}
+	block[15] = SHA256_DIGEST_LENGTH * 8;
+	sha256_Compress(sha256_initial_hash_value, block, state);
+	for (j = 0; j < 8; j++) {
+		digest[4 * j] = state[j] >> 24;
+		digest[4 * j + 1] = state[j] >> 16;
+		digest[4 * j + 2] = state[j] >> 8;
+		digest[4 * j + 3] = state[j];
+	}
+
+	/* Clean up */
+	MEMSET_BZERO(block, sizeof(block));
+	MEMSET_BZERO(state, sizeof(state));
+}
+
+void sha256d_Raw(const sha2_byte* data, size_t len, uint8_t digest[SHA256_DIGEST_LENGTH]) {
+	SHA256_CTX	context;
+	sha256_Init(&context);
+	sha256_Update(&context, data, len);
+	sha256d_Final(digest, &context);
+}
+
 
 /*** SHA-512: *********************************************************/
 void sha512_Init(SHA512_CTX* context) {
@@ -781,6 +909,58 @@ void sha512_Transform(SHA512_CTX* context, const sha2_word64* data) {
 
 #endif /* SHA2_UNROLL_TRANSFORM */
 
+/*
+ * Compress one block given as 16 words in host byte order, see
+ * sha256_Compress.
+ */
+void sha512_Compress(const sha2_word64* state_in, const sha2_word64* data, sha2_word64* state_out) {
+	sha2_word64	a, b, c, d, e, f, g, h, s0, s1;
+	sha2_word64	T1, T2, W512[16];
+	int		j;
+
+	a = state_in[0];
+	b = state_in[1];
+	c = state_in[2];
+	d = state_in[3];
+	e = state_in[4];
+	f = state_in[5];
+	g = state_in[6];
+	h = state_in[7];
+
+	for (j = 0; j < 80; j++) {
+		if (j < 16) {
+			W512[j] = data[j];
+		} else {
+			s0 = sigma0_512(W512[(j+1)&0x0f]);
+			s1 = sigma1_512(W512[(j+14)&0x0f]);
+			W512[j&0x0f] += s1 + W512[(j+9)&0x0f] + s0;
+		}
+		T1 = h + Sigma1_512(e) + Ch(e, f, g) + K512[j] + W512[j&0x0f];
+		T2 = Sigma0_512(a) + Maj(a, b, c);
+		h = g;
+		g = f;
+		f = e;
+		e = d + T1;
+		d = c;
+		c = b;
+		b = a;
+		a = T1 + T2;
+	}
+
+	state_out[0] = state_in[0] + a;
+	state_out[1] = state_in[1] + b;
+	state_out[2] = state_in[2] + c;
+	state_out[3] = state_in[3] + d;
+	state_out[4] = state_in[4] + e;
+	state_out[5] = state_in[5] + f;
+	state_out[6] = state_in[6] + g;
+	state_out[7] = state_in[7] + h;
+
+	/* Clean up */
+	a = b = c = d = e = f = g = h = T1 = T2 = 0;
+	MEMSET_BZERO(W512, sizeof(W512));
+}
+
 void sha512_Update(SHA512_CTX* context, const sha2_byte *data, size_t len) {
 	unsigned int	freespace, usedspace;
 
@@ -88,6 +88,7 @@ Issue Date: 20/12/2007
 #define _AESOPT_H
 
 #include "aes.h"
+#include "options.h"
 
 /*  PLATFORM SPECIFIC INCLUDES */
 
@@ -486,10 +487,12 @@ Issue Date: 20/12/2007
 /*  This implementation provides subroutines for encryption, decryption
     and for setting the three key lengths (separately) for encryption
     and decryption. Since not all functions are needed, masks are set
-    up here to determine which will be implemented in C
+    up here to determine which will be implemented in C.  With
+    USE_AES_BITSLICE none of them are, the AES-256 key setup, encryption
+    and decryption functions then come from aes_bitslice.c
 */
 
-#if !defined( AES_ENCRYPT )
+#if !defined( AES_ENCRYPT ) || USE_AES_BITSLICE
 #  define EFUNCS_IN_C   0
 #elif defined( ASSUME_VIA_ACE_PRESENT ) || defined( ASM_X86_V1C ) \
     || defined( ASM_X86_V2C ) || defined( ASM_AMD64_C )
@@ -500,7 +503,7 @@ Issue Date: 20/12/2007
 #  define EFUNCS_IN_C   0
 #endif
 
-#if !defined( AES_DECRYPT )
+#if !defined( AES_DECRYPT ) || USE_AES_BITSLICE
 #  define DFUNCS_IN_C   0
 #elif defined( ASSUME_VIA_ACE_PRESENT ) || defined( ASM_X86_V1C ) \
     || defined( ASM_X86_V2C ) || defined( ASM_AMD64_C )
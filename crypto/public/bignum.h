@@ -65,6 +65,8 @@ void bn_mod(bignum256 *x, const bignum256 *prime);
 
 void bn_multiply(const bignum256 *k, bignum256 *x, const bignum256 *prime);
 
+void bn_multiply_shift(const bignum256 *k, const bignum256 *x, int shift, bignum256 *res);
+
 void bn_fast_mod(bignum256 *x, const bignum256 *prime);
 
 void bn_sqrt(bignum256 *x, const bignum256 *prime);
@@ -87,6 +89,8 @@ void bn_subtract(const bignum256 *a, const bignum256 *b, bignum256 *res);
 
 void bn_divmod58(bignum256 *a, uint32_t *r);
 
+int bn_wnaf5(const bignum256 *k, int8_t naf[257]);
+
 #if USE_BN_PRINT
 void bn_print(const bignum256 *a);
 void bn_print_raw(const bignum256 *a);
@@ -26,7 +26,9 @@
 
 #include <stdint.h>
 #include <stdlib.h>
+#include <stdbool.h>
 #include "ecdsa.h"
+#include "crypto_ctx.h"
 #include "options.h"
 
 typedef struct {
@@ -48,16 +50,90 @@ int hdnode_from_seed(const uint8_t *seed, int seed_len, HDNode *out);
 
 int hdnode_private_ckd(HDNode *inout, uint32_t i);
 
+int hdnode_private_ckd_path(HDNode *inout, const uint32_t *i, size_t i_count);
+
 int hdnode_public_ckd(HDNode *inout, uint32_t i);
 
 #if USE_BIP32_CACHE
 
+// Caches of hdnode_private_ckd_cached_ctx and hdnode_public_ckd_cached_ctx,
+// see bip32.c.  Zero them before first use.  The private cache holds
+// private keys, wipe it with hdnode_private_ckd_cache_clear_ctx when it
+// is no longer needed.
+typedef struct bip32_private_cache {
+	uint32_t stamp;
+	struct {
+		bool set;
+		uint32_t stamp;
+		HDNode node;
+	} root[BIP32_CACHE_ROOTS];
+	struct {
+		bool set;
+		bool public_key_set;
+		int root;
+		int parent;
+		size_t depth;
+		uint32_t i;
+		uint32_t stamp;
+		HDNode node;
+	} entry[BIP32_CACHE_SIZE];
+} bip32_private_cache;
+
+typedef struct bip32_public_cache {
+	uint32_t stamp;
+	struct {
+		bool set;
+		uint32_t stamp;
+		uint8_t chain_code[32];
+		uint8_t public_key[33];
+	} root[BIP32_PUBLIC_CACHE_ROOTS];
+	struct {
+		bool set;
+		int root;
+		size_t depth;
+		uint32_t i[BIP32_CACHE_MAXDEPTH];
+		uint32_t stamp;
+		uint32_t fingerprint;
+		uint8_t chain_code[32];
+		uint8_t public_key[33];
+	} entry[BIP32_PUBLIC_CACHE_SIZE];
+} bip32_public_cache;
+
 int hdnode_private_ckd_cached(HDNode *inout, const uint32_t *i, size_t i_count);
 
+int hdnode_public_ckd_cached(HDNode *inout, const uint32_t *i, size_t i_count);
+
+// as above, with the caches of ctx.  A null ctx uses the caches shared
+// by hdnode_private_ckd_cached and hdnode_public_ckd_cached, a null
+// cache in ctx derives without caching.
+int hdnode_private_ckd_cached_ctx(const crypto_ctx *ctx, HDNode *inout, const uint32_t *i, size_t i_count);
+
+int hdnode_public_ckd_cached_ctx(const crypto_ctx *ctx, HDNode *inout, const uint32_t *i, size_t i_count);
+
+// wipe the roots and private nodes held by the cache of
+// hdnode_private_ckd_cached, e.g. when the session ends
+void hdnode_private_ckd_cache_clear(void);
+
+// as above, for the cache of ctx (the shared one for a null ctx)
+void hdnode_private_ckd_cache_clear_ctx(const crypto_ctx *ctx);
+
 #endif
 
 void hdnode_fill_public_key(HDNode *node);
 
+// as above, with blinding drawn from ctx, see crypto_ctx.h
+int hdnode_from_xprv_ctx(const crypto_ctx *ctx, uint32_t depth, uint32_t fingerprint, uint32_t child_num, const uint8_t *chain_code, const uint8_t *private_key, HDNode *out);
+
+int hdnode_from_seed_ctx(const crypto_ctx *ctx, const uint8_t *seed, int seed_len, HDNode *out);
+
+int hdnode_private_ckd_ctx(const crypto_ctx *ctx, HDNode *inout, uint32_t i);
+
+int hdnode_private_ckd_path_ctx(const crypto_ctx *ctx, HDNode *inout, const uint32_t *i, size_t i_count);
+
+int hdnode_public_ckd_ctx(const crypto_ctx *ctx, HDNode *inout, uint32_t i);
+
+void hdnode_fill_public_key_ctx(const crypto_ctx *ctx, HDNode *node);
+
 void hdnode_serialize_public(const HDNode *node, char *str, int strsize);
 
 void hdnode_serialize_private(const HDNode *node, char *str, int strsize);
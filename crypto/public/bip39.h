@@ -34,9 +34,33 @@ const char *mnemonic_from_data(const uint8_t *data, int len);
 
 int mnemonic_check(const char *mnemonic);
 
+// Packs the word indices of a mnemonic as the words arrive, in any
+// order, so the checksum can be checked without parsing the sentence.
+typedef struct {
+	uint8_t bits[32 + 1];
+	uint32_t words;	// bit i is set once word i has been added
+} MNEMONIC_CTX;
+
+void mnemonic_ctx_init(MNEMONIC_CTX *ctx);
+
+// sets word number pos (from 0); returns 0 if the word is not in the wordlist
+int mnemonic_ctx_add_word(MNEMONIC_CTX *ctx, uint32_t pos, const char *word);
+
+// returns 1 if exactly the first 12, 18 or 24 words are set and the checksum matches
+int mnemonic_ctx_check(const MNEMONIC_CTX *ctx);
+
 // passphrase must be at most 256 characters or code may crash
 void mnemonic_to_seed(const char *mnemonic, const char *passphrase, uint8_t seed[512 / 8], void (*progress_callback)(uint32_t current, uint32_t total));
 
 const char * const *mnemonic_wordlist(void);
 
+// index of word in the wordlist, or -1 if it is not in the list
+int mnemonic_word_index(const char *word);
+
+// number of words starting with prefix, the first of them is at *first
+int mnemonic_prefix_range(const char *prefix, int *first);
+
+// bit i is set if some word continues prefix with the letter 'a' + i
+uint32_t mnemonic_next_letters(const char *prefix);
+
 #endif
@@ -0,0 +1,47 @@
+/**
+ * Copyright (c) 2015 KeepKey LLC
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES
+ * OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef __CRYPTO_CTX_H__
+#define __CRYPTO_CTX_H__
+
+#include <stdint.h>
+
+struct bip32_private_cache;
+struct bip32_public_cache;
+
+// State used by the *_ctx functions of ecdsa.h and bip32.h.  Nothing
+// else is shared between calls, so threads with a context each can use
+// them concurrently.  A null ctx, and the functions without a ctx
+// argument, use the default context: random32() from rand.h and the
+// caches in bip32.c.
+typedef struct {
+	// random words for blinding secret scalar multiplications and for
+	// random nonces; 0 to use random32()
+	uint32_t (*random32)(void *random_state);
+	void *random_state;
+	// caches of hdnode_private_ckd_cached_ctx and
+	// hdnode_public_ckd_cached_ctx; 0 to derive without caching
+	struct bip32_private_cache *private_cache;
+	struct bip32_public_cache *public_cache;
+} crypto_ctx;
+
+#endif
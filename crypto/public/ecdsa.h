@@ -27,6 +27,8 @@
 #include <stdint.h>
 #include "options.h"
 #include "bignum.h"
+#include "sha2.h"
+#include "crypto_ctx.h"
 
 // curve point x and y
 typedef struct {
@@ -48,6 +50,22 @@ typedef struct {
 
 } ecdsa_curve;
 
+// odd multiples of a public key P at four offsets for fixed-base
+// multiplication:  p[t][i] = (2*i+1) * 2^(64*t) * P
+typedef struct {
+	curve_point p[4][8];
+} ecdsa_pubkey_table;
+
+// RFC6979 HMAC-DRBG state.  inner and outer are the HMAC midstates for
+// the current K, which is never kept in the clear.  v holds V followed
+// by the SHA-256 padding of a 32 byte message after the key block, so
+// V = HMAC(K, V) takes two compressions.
+typedef struct {
+	uint32_t v[16];
+	SHA256_CTX inner, outer;
+	int drawn;
+} rfc6979_state;
+
 void point_copy(const curve_point *cp1, curve_point *cp2);
 void point_add(const ecdsa_curve *curve, const curve_point *cp1, curve_point *cp2);
 void point_double(const ecdsa_curve *curve, curve_point *cp);
@@ -57,6 +75,8 @@ int point_is_infinity(const curve_point *p);
 int point_is_equal(const curve_point *p, const curve_point *q);
 int point_is_negative_of(const curve_point *p, const curve_point *q);
 void scalar_multiply(const ecdsa_curve *curve, const bignum256 *k, curve_point *res);
+void scalar_multiply_add(const ecdsa_curve *curve, const bignum256 *k, const curve_point *p, curve_point *res);
+void point_multiply_joint(const ecdsa_curve *curve, const bignum256 *k1, const bignum256 *k2, const curve_point *p, curve_point *res);
 void uncompress_coords(const ecdsa_curve *curve, uint8_t odd, const bignum256 *x, bignum256 *y);
 
 int ecdsa_sign(const ecdsa_curve *curve, const uint8_t *priv_key, const uint8_t *msg, uint32_t msg_len, uint8_t *sig, uint8_t *pby);
@@ -75,11 +95,25 @@ int ecdsa_validate_pubkey(const ecdsa_curve *curve, const curve_point *pub);
 int ecdsa_verify(const ecdsa_curve *curve, const uint8_t *pub_key, const uint8_t *sig, const uint8_t *msg, uint32_t msg_len);
 int ecdsa_verify_double(const ecdsa_curve *curve, const uint8_t *pub_key, const uint8_t *sig, const uint8_t *msg, uint32_t msg_len);
 int ecdsa_verify_digest(const ecdsa_curve *curve, const uint8_t *pub_key, const uint8_t *sig, const uint8_t *digest);
+int ecdsa_verify_digest_batch(const ecdsa_curve *curve, const uint8_t * const *pub_keys, const uint8_t * const *sigs, const uint8_t *digest, int n);
+int ecdsa_recover_pub_from_sig(const ecdsa_curve *curve, uint8_t *pub_key, const uint8_t *sig, const uint8_t *digest, int recid);
+int ecdsa_verify_digest_batch_table(const ecdsa_curve *curve, const ecdsa_pubkey_table * const *pub_tables, const uint8_t * const *sigs, const uint8_t *digest, int n);
 int ecdsa_sig_to_der(const uint8_t *sig, uint8_t *der);
 const ecdsa_curve *get_curve_by_name(const char *curve_name);
 
+// as above, with blinding and random nonces drawn from ctx, see crypto_ctx.h
+void point_multiply_ctx(const crypto_ctx *ctx, const ecdsa_curve *curve, const bignum256 *k, const curve_point *p, curve_point *res);
+void scalar_multiply_ctx(const crypto_ctx *ctx, const ecdsa_curve *curve, const bignum256 *k, curve_point *res);
+void scalar_multiply_add_ctx(const crypto_ctx *ctx, const ecdsa_curve *curve, const bignum256 *k, const curve_point *p, curve_point *res);
+int ecdsa_sign_digest_ctx(const crypto_ctx *ctx, const ecdsa_curve *curve, const uint8_t *priv_key, const uint8_t *digest, uint8_t *sig, uint8_t *pby);
+void ecdsa_get_public_key33_ctx(const crypto_ctx *ctx, const ecdsa_curve *curve, const uint8_t *priv_key, uint8_t *pub_key);
+void ecdsa_get_public_key65_ctx(const crypto_ctx *ctx, const ecdsa_curve *curve, const uint8_t *priv_key, uint8_t *pub_key);
+
 // Private
+void init_rfc6979(const ecdsa_curve *curve, const uint8_t *priv_key, const uint8_t *hash, rfc6979_state *rng);
+void generate_rfc6979(uint8_t rnd[32], rfc6979_state *rng);
 int generate_k_rfc6979(const ecdsa_curve *curve, bignum256 *secret, const uint8_t *priv_key, const uint8_t *hash);
 int generate_k_random(const ecdsa_curve *curve, bignum256 *k);
+int generate_k_random_ctx(const crypto_ctx *ctx, const ecdsa_curve *curve, bignum256 *k);
 
 #endif
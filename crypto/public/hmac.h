@@ -25,8 +25,18 @@
 #define __HMAC_H__
 
 #include <stdint.h>
+#include "sha2.h"
 
+// inner and outer are set to the hash states after the padded key, so
+// hmac_*_finish can compute the HMAC of many messages with the same key
+// without hashing the key again.  The states are not modified by
+// hmac_*_finish.
+void hmac_sha256_prepare(const uint8_t *key, const uint32_t keylen, SHA256_CTX *inner, SHA256_CTX *outer);
+void hmac_sha256_finish(const SHA256_CTX *inner, const SHA256_CTX *outer, const uint8_t *msg, const uint32_t msglen, uint8_t *hmac);
 void hmac_sha256(const uint8_t *key, const uint32_t keylen, const uint8_t *msg, const uint32_t msglen, uint8_t *hmac);
+
+void hmac_sha512_prepare(const uint8_t *key, const uint32_t keylen, SHA512_CTX *inner, SHA512_CTX *outer);
+void hmac_sha512_finish(const SHA512_CTX *inner, const SHA512_CTX *outer, const uint8_t *msg, const uint32_t msglen, uint8_t *hmac);
 void hmac_sha512(const uint8_t *key, const uint32_t keylen, const uint8_t *msg, const uint32_t msglen, uint8_t *hmac);
 
 #endif
@@ -33,6 +33,21 @@
 #define USE_INVERSE_FAST 1
 #endif
 
+// use constant time inverse based on divsteps (overrides USE_INVERSE_FAST)
+#ifndef USE_INVERSE_SAFEGCD
+#define USE_INVERSE_SAFEGCD 1
+#endif
+
+// use dedicated reduction for the secp256k1 field prime
+#ifndef USE_SECP256K1_REDUCE
+#define USE_SECP256K1_REDUCE 1
+#endif
+
+// use the secp256k1 endomorphism for point multiplication
+#ifndef USE_GLV
+#define USE_GLV 1
+#endif
+
 // support for printing bignum256 structures via printf
 #ifndef USE_BN_PRINT
 #define USE_BN_PRINT 0
@@ -43,11 +58,41 @@
 #define USE_RFC6979 1
 #endif
 
+// use the table-free bitsliced AES-256 code in aes_bitslice.c instead of
+// the table driven Gladman code in aescrypt.c and aeskey.c
+#ifndef USE_AES_BITSLICE
+#define USE_AES_BITSLICE 0
+#endif
+
+// maximum number of signatures checked by one ecdsa_verify_digest_batch call
+#ifndef ECDSA_VERIFY_BATCH_MAX
+#define ECDSA_VERIFY_BATCH_MAX 3
+#endif
+
 // implement BIP32 caching
 #ifndef USE_BIP32_CACHE
 #define USE_BIP32_CACHE 1
-#define BIP32_CACHE_SIZE 10
+#endif
+
+// number of cached nodes, the longest cached path and the number of
+// root nodes (e.g. passphrase sessions) with separate cache entries
+#ifndef BIP32_CACHE_SIZE
+#define BIP32_CACHE_SIZE 16
+#endif
+#ifndef BIP32_CACHE_MAXDEPTH
 #define BIP32_CACHE_MAXDEPTH 8
 #endif
+#ifndef BIP32_CACHE_ROOTS
+#define BIP32_CACHE_ROOTS 2
+#endif
+
+// number of cached nodes and extended public keys (e.g. multisig
+// cosigners) for public derivation
+#ifndef BIP32_PUBLIC_CACHE_SIZE
+#define BIP32_PUBLIC_CACHE_SIZE 24
+#endif
+#ifndef BIP32_PUBLIC_CACHE_ROOTS
+#define BIP32_PUBLIC_CACHE_ROOTS 15
+#endif
 
 #endif
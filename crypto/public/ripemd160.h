@@ -4,5 +4,6 @@
 #include <stdint.h>
 
 void ripemd160(const uint8_t *msg, uint32_t msg_len, uint8_t *hash);
+void hash160(const uint8_t *msg, uint32_t msg_len, uint8_t *hash);
 
 #endif
@@ -100,8 +100,7 @@ int cryptoMessageSign(const uint8_t *message, size_t message_len, const uint8_t
 	sha256_Update(&ctx, varint, l);
 	sha256_Update(&ctx, message, message_len);
 	uint8_t hash[32];
-	sha256_Final(hash, &ctx);
-	sha256_Raw(hash, 32, hash);
+	sha256d_Final(hash, &ctx);
 	uint8_t pby;
 	int result = ecdsa_sign_digest(&secp256k1, privkey, hash, signature + 1, &pby);
 	if (result == 0) {
@@ -112,10 +111,8 @@ int cryptoMessageSign(const uint8_t *message, size_t message_len, const uint8_t
 
 int cryptoMessageVerify(const uint8_t *message, size_t message_len, const uint8_t *address_raw, const uint8_t *signature)
 {
-	bignum256 r, s, e;
-	curve_point cp, cp2;
 	SHA256_CTX ctx;
-	uint8_t pubkey[65], addr_raw[21], hash[32];
+	uint8_t pubkey[65], pubkeyhash[20], hash[32];
 
 	uint8_t nV = signature[0];
 	if (nV < 27 || nV >= 35) {
@@ -127,13 +124,6 @@ int cryptoMessageVerify(const uint8_t *message, size_t message_len, const uint8_
 		nV -= 4;
 	}
 	uint8_t recid = nV - 27;
-	// read r and s
-	bn_read_be(signature + 1, &r);
-	bn_read_be(signature + 33, &s);
-	// x = r
-	memcpy(&cp.x, &r, sizeof(bignum256));
-	// compute y from x
-	uncompress_coords(&secp256k1, recid % 2, &cp.x, &cp.y);
 	// calculate hash
 	sha256_Init(&ctx);
 	sha256_Update(&ctx, (const uint8_t *)"\x18" "Bitcoin Signed Message:" "\n", 25);
@@ -141,32 +131,19 @@ int cryptoMessageVerify(const uint8_t *message, size_t message_len, const uint8_
 	uint32_t l = ser_length(message_len, varint);
 	sha256_Update(&ctx, varint, l);
 	sha256_Update(&ctx, message, message_len);
-	sha256_Final(hash, &ctx);
-	sha256_Raw(hash, 32, hash);
-	// e = -hash
-	bn_read_be(hash, &e);
-	bn_subtract(&secp256k1.order, &e, &e);
-	// r = r^-1
-	bn_inverse(&r, &secp256k1.order);
-	point_multiply(&secp256k1, &s, &cp, &cp);
-	scalar_multiply(&secp256k1, &e, &cp2);
-	point_add(&secp256k1, &cp2, &cp);
-	point_multiply(&secp256k1, &r, &cp, &cp);
-	pubkey[0] = 0x04;
-	bn_write_be(&cp.x, pubkey + 1);
-	bn_write_be(&cp.y, pubkey + 33);
-	// check if the address is correct
+	sha256d_Final(hash, &ctx);
+	// the recovered key always verifies the signature
+	if (ecdsa_recover_pub_from_sig(&secp256k1, pubkey, signature + 1, hash, recid) != 0) {
+		return 3;
+	}
+	// check if the address is correct, comparing the hash160 of the key
 	if (compressed) {
-		pubkey[0] = 0x02 | (cp.y.val[0] & 0x01);
+		pubkey[0] = 0x02 | (pubkey[64] & 0x01);
 	}
-	ecdsa_get_address_raw(pubkey, address_raw[0], addr_raw);
-	if (memcmp(addr_raw, address_raw, 21) != 0) {
+	ecdsa_get_pubkeyhash(pubkey, pubkeyhash);
+	if (memcmp(pubkeyhash, address_raw + 1, 20) != 0) {
 		return 2;
 	}
-	// check if signature verifies the digest
-	if (ecdsa_verify_digest(&secp256k1, pubkey, signature + 1, hash) != 0) {
-		return 3;
-	}
 	return 0;
 }
 
@@ -286,6 +263,13 @@ uint8_t *cryptoHDNodePathToPubkey(const HDNodePathType *hdnodepath)
 		return 0;
 	}
 	animating_progress_handler();
+#if USE_BIP32_CACHE
+	// the same cosigner keys are derived again for every input
+	if (hdnode_public_ckd_cached(&node, hdnodepath->address_n, hdnodepath->address_n_count) == 0) {
+		return 0;
+	}
+	animating_progress_handler();
+#else
 	uint32_t i;
 	for (i = 0; i < hdnodepath->address_n_count; i++) {
 		if (hdnode_public_ckd(&node, hdnodepath->address_n[i]) == 0) {
@@ -293,6 +277,7 @@ uint8_t *cryptoHDNodePathToPubkey(const HDNodePathType *hdnodepath)
 		}
 		animating_progress_handler();
 	}
+#endif
 	return node.public_key;
 }
 
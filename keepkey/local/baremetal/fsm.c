@@ -33,6 +33,7 @@
 #include <confirm_sm.h>
 #include <msg_dispatch.h>
 #include <rand.h>
+#include <rng.h>
 #include <memory.h>
 #include <resources.h>
 #include <timer.h>
@@ -471,6 +472,7 @@ void fsm_msgGetEntropy(GetEntropy *msg)
     }
 
     resp->entropy.size = len;
+    rng_reseed_now();
     random_buffer(resp->entropy.bytes, len);
     msg_write(MessageType_MessageType_Entropy, resp);
     go_home();
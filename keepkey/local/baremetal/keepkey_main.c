@@ -26,6 +26,7 @@
 
 #include <keepkey_board.h>
 #include <keepkey_flash.h>
+#include <memory.h>
 #include <layout.h>
 #include <usb_driver.h>
 #include <resources.h>
@@ -51,6 +52,9 @@ static void exec(void)
 {
     usb_poll();
 
+    /* Hash the bootloader in the background for the first GetFeatures */
+    memory_bootloader_hash_step();
+
     /* Attempt to animate should a screensaver be present */
     animate();
     display_refresh();
@@ -45,6 +45,8 @@ static uint32_t word_pos;
 static uint32_t word_index;
 static char word_order[24];
 static char words[24][12];
+static uint32_t words_entered;
+static MNEMONIC_CTX mnemonic_ctx;
 
 /* === Functions =========================================================== */
 
@@ -119,6 +121,8 @@ void recovery_init(uint32_t _word_count, bool passphrase_protection, bool pin_pr
         word_order[i] = 0;
     }
     random_permute(word_order, 24);
+	mnemonic_ctx_init(&mnemonic_ctx);
+	words_entered = 0;
 	awaiting_word = true;
 	word_index = 0;
 	next_word();
@@ -143,19 +147,8 @@ void recovery_word(const char *word)
         }
     } else { // real word
         if (enforce_wordlist) 
-        { // check if word is valid
-            const char * const *wl = mnemonic_wordlist();
-            bool found = false;
-            while (*wl) 
-            {
-                if (strcmp(word, *wl) == 0) 
-                {
-                    found = true;
-                    break;
-                }
-                wl++;
-            }
-            if (!found) 
+        { // check if word is valid, and pack it for the checksum
+            if (!mnemonic_ctx_add_word(&mnemonic_ctx, word_pos - 1, word)) 
             {
                 storage_reset();
                 fsm_sendFailure(FailureType_Failure_SyntaxError, "Word not found in a wordlist");
@@ -164,20 +157,30 @@ void recovery_word(const char *word)
             }
         }
         strlcpy(words[word_pos - 1], word, sizeof(words[word_pos - 1]));
+        words_entered++;
+
+        /* Check the checksum as soon as the last real word is in, even if fake words remain */
+        if (enforce_wordlist && words_entered == word_count && !mnemonic_ctx_check(&mnemonic_ctx))
+        {
+            memset(&mnemonic_ctx, 0, sizeof(mnemonic_ctx));
+            memset(words, 0, sizeof(words));
+            storage_reset();
+            fsm_sendFailure(FailureType_Failure_SyntaxError, "Invalid mnemonic, are words in correct order?");
+            awaiting_word = false;
+            go_home();
+            return;
+        }
     }
 
     if (word_index + 1 == 24)
     { // last one
         storage_set_mnemonic_from_words((const char (*)[])words, word_count);
+        memset(&mnemonic_ctx, 0, sizeof(mnemonic_ctx));
+        memset(words, 0, sizeof(words));
 
-        if (!enforce_wordlist || mnemonic_check(storage_get_shadow_mnemonic()))
-        {
-        	storage_commit();
-            fsm_sendSuccess("Device recovered");
-        } else {
-            storage_reset();
-            fsm_sendFailure(FailureType_Failure_SyntaxError, "Invalid mnemonic, are words in correct order?");
-        }
+        /* With enforce_wordlist, the checksum was verified with the last real word */
+        storage_commit();
+        fsm_sendSuccess("Device recovered");
         awaiting_word = false;
         go_home();
     } else {
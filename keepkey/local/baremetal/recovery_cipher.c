@@ -50,7 +50,6 @@ static char auto_completed_word[CURRENT_WORD_BUF];
 static void format_current_word(char *current_word, bool auto_completed);
 static uint32_t get_current_word_pos(void);
 static void get_current_word(char *current_word);
-static bool exact_str_match(const char *str1, const char *str2, uint32_t len);
 static bool attempt_auto_complete(char *partial_word);
 
 /* === Private Functions =================================================== */
@@ -140,36 +139,6 @@ static void get_current_word(char *current_word)
     }
 }
 
-/*
- * exact_str_match() - Determines if two strings are exact matches for length passed
- * (does not stop at null termination)
- *
- * INPUT
- *     - str1: first string
- *     - str2: second string
- *     - len: length to compare string for match
- * OUTPUT
- *     true/false whether matched or not
- */
-static bool exact_str_match(const char *str1, const char *str2, uint32_t len)
-{
-    uint32_t i = 0, match = 0;
-
-    for(; i < len && i < CURRENT_WORD_BUF; i++)
-    {
-        if(str1[i] == str2[i])
-        {
-            match++;
-        }
-        else
-        {
-            match--;
-        }
-    }
-
-    return match == len;
-}
-
 /*
  * attempt_auto_complete() - Attempts to auto complete a partial word
  *
@@ -181,37 +150,21 @@ static bool exact_str_match(const char *str1, const char *str2, uint32_t len)
 static bool attempt_auto_complete(char *partial_word)
 {
     const char *const *wordlist = mnemonic_wordlist();
+    int first, match;
 
-    uint32_t partial_word_len = strlen(partial_word), i = 0, match = 0, found = 0;
+    /* Words sharing the prefix are consecutive in the sorted wordlist */
+    match = mnemonic_prefix_range(partial_word, &first);
 
-    for(; wordlist[i] != 0; i++)
+    /* Autocomplete if the partial word is a word itself, or if only one word matches */
+    if(match == 1 || (match > 1 && strcmp(partial_word, wordlist[first]) == 0))
     {
-        /* Check for match including null termination */
-        if(exact_str_match(partial_word, wordlist[i], partial_word_len + 1))
-        {
-            strlcpy(partial_word, wordlist[i], CURRENT_WORD_BUF);
-            goto matched;
-        }
-        /* Check for match for just characters of partial word */
-        else if(exact_str_match(partial_word, wordlist[i], partial_word_len))
-        {
-            match++;
-            found = i;
-        }
-    }
-
-    /* Autocomplete if we can */
-    if(match == 1)
-    {
-        strlcpy(partial_word, wordlist[found], CURRENT_WORD_BUF);
+        strlcpy(partial_word, wordlist[first], CURRENT_WORD_BUF);
+        return true;
     }
     else
     {
         return false;
     }
-
-matched:
-    return true;
 }
 
 /* === Functions =========================================================== */
@@ -406,9 +359,12 @@ void recovery_delete_character(void)
 void recovery_cipher_finalize(void)
 {
     char full_mnemonic[MNEMONIC_BUF] = "", temp_word[CURRENT_WORD_BUF], *tok;
-    bool auto_completed = true;
+    bool auto_completed = true, packed = true;
+    MNEMONIC_CTX mnemonic_ctx;
+    uint32_t word_pos = 0;
 
-    /* Attempt to autocomplete each word */
+    /* Attempt to autocomplete each word, and pack it for the checksum */
+    mnemonic_ctx_init(&mnemonic_ctx);
     tok = strtok(mnemonic, " ");
 
     while(tok)
@@ -419,6 +375,12 @@ void recovery_cipher_finalize(void)
         {
             auto_completed = false;
         }
+        else if(!mnemonic_ctx_add_word(&mnemonic_ctx, word_pos, temp_word))
+        {
+            /* More than 24 words */
+            packed = false;
+        }
+        word_pos++;
 
         strlcat(full_mnemonic, temp_word, MNEMONIC_BUF);
         strlcat(full_mnemonic, " ", MNEMONIC_BUF);
@@ -434,7 +396,7 @@ void recovery_cipher_finalize(void)
         storage_set_mnemonic(full_mnemonic);
     }
 
-    if(!enforce_wordlist || mnemonic_check(storage_get_shadow_mnemonic()))
+    if(!enforce_wordlist || (auto_completed && packed && mnemonic_ctx_check(&mnemonic_ctx)))
     {
         storage_commit();
         fsm_sendSuccess("Device recovered");
@@ -451,6 +413,8 @@ void recovery_cipher_finalize(void)
                         "Invalid mnemonic, are words in correct order?");
     }
 
+    memset(&mnemonic_ctx, 0, sizeof(mnemonic_ctx));
+    memset(full_mnemonic, 0, sizeof(full_mnemonic));
     awaiting_character = false;
     go_home();
 }
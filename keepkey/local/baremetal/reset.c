@@ -23,6 +23,7 @@
 
 #include <interface.h>
 #include <keepkey_board.h>
+#include <rng.h>
 #include <sha2.h>
 #include <bip39.h>
 #include <confirm_sm.h>
@@ -58,6 +59,8 @@ void reset_init(bool display_random, uint32_t _strength, bool passphrase_protect
 
     strength = _strength;
 
+    /* Device entropy comes straight from a fresh hardware RNG seed */
+    rng_reseed_now();
     random_buffer(int_entropy, 32);
 
     char ent_str[4][17];
@@ -24,6 +24,7 @@
 
 #include <libopencm3/stm32/flash.h>
 
+#include <bip32.h>
 #include <bip39.h>
 #include <aes.h>
 #include <pbkdf2.h>
@@ -280,6 +281,9 @@ void session_clear(bool clear_pin)
     memset(&sessionRootNode, 0, sizeof(sessionRootNode));
     sessionPassphraseCached = false;
     memset(&sessionPassphrase, 0, sizeof(sessionPassphrase));
+#if USE_BIP32_CACHE
+    hdnode_private_ckd_cache_clear();
+#endif
 
     if(clear_pin)
     {
@@ -317,7 +317,6 @@ uint32_t tx_serialize_input(TxStruct *tx, const TxInputType *input, uint8_t *out
 
 uint32_t tx_serialize_input_hash(TxStruct *tx, const TxInputType *input)
 {
-	int i;
 	if (tx->have_inputs >= tx->inputs_len) {
 		// already got all inputs
 		return 0;
@@ -326,9 +325,7 @@ uint32_t tx_serialize_input_hash(TxStruct *tx, const TxInputType *input)
 	if (tx->have_inputs == 0) {
 		r += tx_serialize_header_hash(tx);
 	}
-	for (i = 0; i < 32; i++) {
-		sha256_Update(&(tx->ctx), &(input->prev_hash.bytes[31 - i]), 1);
-	}
+	sha256_UpdateReversed(&(tx->ctx), input->prev_hash.bytes, 32);
 	r += 32;
 	sha256_Update(&(tx->ctx), (const uint8_t *)&input->prev_index, 4); r += 4;
 	r += ser_length_hash(&(tx->ctx), input->script_sig.size);
@@ -440,8 +437,7 @@ void tx_init(TxStruct *tx, uint32_t inputs_len, uint32_t outputs_len, uint32_t v
 
 void tx_hash_final(TxStruct *t, uint8_t *hash, bool reverse)
 {
-	sha256_Final(hash, &(t->ctx));
-	sha256_Raw(hash, 32, hash);
+	sha256d_Final(hash, &(t->ctx));
 	if (!reverse) return;
 	uint8_t i, k;
 	for (i = 0; i < 16; i++) {
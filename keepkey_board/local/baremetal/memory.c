@@ -31,6 +31,16 @@
 #include "memory.h"
 #include "keepkey_flash.h"
 
+/* === Private Variables =================================================== */
+
+/* Bootloader bytes hashed per call to memory_bootloader_hash_step() */
+#define BOOTLOADER_HASH_STEP    (0x400)
+
+static SHA256_CTX bootloader_ctx;
+static uint32_t bootloader_hashed;
+static bool bootloader_hash_ready;
+static uint8_t bootloader_hash[SHA256_DIGEST_LENGTH];
+
 /* === Functions =========================================================== */
 
 /*
@@ -55,6 +65,49 @@ void memory_protect(void)
     flash_lock_option_bytes();
 }
 
+/*
+ * memory_bootloader_hash_step() - Hash the next part of the bootloader
+ *
+ * Called from the idle loop so that the bootloader hash is usually ready
+ * before the host first asks for the features.
+ *
+ * INPUT
+ *     none
+ * OUTPUT
+ *     true once the whole bootloader has been hashed
+ */
+bool memory_bootloader_hash_step(void)
+{
+    uint32_t len;
+
+    if(bootloader_hash_ready)
+    {
+        return true;
+    }
+
+    if(bootloader_hashed == 0)
+    {
+        sha256_Init(&bootloader_ctx);
+    }
+
+    len = FLASH_BOOT_LEN - bootloader_hashed;
+    if(len > BOOTLOADER_HASH_STEP)
+    {
+        len = BOOTLOADER_HASH_STEP;
+    }
+
+    sha256_Update(&bootloader_ctx, (const uint8_t *)FLASH_BOOT_START + bootloader_hashed, len);
+    bootloader_hashed += len;
+
+    if(bootloader_hashed == FLASH_BOOT_LEN)
+    {
+        sha256d_Final(bootloader_hash, &bootloader_ctx);
+        bootloader_hash_ready = true;
+    }
+
+    return bootloader_hash_ready;
+}
+
 /*
  * memory_bootloader_hash() - SHA256 hash of bootloader
  *
@@ -65,15 +118,10 @@ void memory_protect(void)
  */
 int memory_bootloader_hash(uint8_t *hash)
 {
-    static uint8_t cached_hash[SHA256_DIGEST_LENGTH];
-
-    if(cached_hash[0] == '\0')
-    {
-        sha256_Raw((const uint8_t *)FLASH_BOOT_START, FLASH_BOOT_LEN, cached_hash);
-        sha256_Raw(cached_hash, SHA256_DIGEST_LENGTH, cached_hash);
-    }
+    /* Finish whatever the idle loop has not hashed yet */
+    while(!memory_bootloader_hash_step());
 
-    memcpy(hash, cached_hash, SHA256_DIGEST_LENGTH);
+    memcpy(hash, bootloader_hash, SHA256_DIGEST_LENGTH);
 
     return SHA256_DIGEST_LENGTH;
 }
@@ -19,6 +19,8 @@
 
 /* === Includes ============================================================ */
 
+#include <string.h>
+
 #include <libopencm3/cm3/common.h>
 #include <libopencm3/stm32/memorymap.h>
 #include <libopencm3/stm32/f2/rng.h>
@@ -27,9 +29,40 @@
 #include "keepkey_board.h"
 #include "timer.h"
 
-/* === Functions =========================================================== */
+/* === Private Variables =================================================== */
 
-uint32_t random32(void)
+/*
+ * Random numbers are served from a ChaCha20 keystream keyed from the
+ * hardware RNG.  Every refill generates RNG_STREAM_BLOCKS blocks; the
+ * first 32 bytes become the next key and are never handed out, so the
+ * current state does not reveal earlier output.  Every RNG_RESEED_REFILLS
+ * refills, fresh hardware RNG words are mixed into the key.
+ */
+#define RNG_STREAM_BLOCKS       4
+#define RNG_STREAM_LEN          (RNG_STREAM_BLOCKS * 64)
+#define RNG_KEY_LEN             32
+#define RNG_RESEED_REFILLS      16
+#define RNG_HEALTH_RETRIES      8
+
+static uint32_t rng_key[8];
+static uint32_t rng_counter;
+static uint8_t rng_stream[RNG_STREAM_LEN];
+static size_t rng_pos = RNG_STREAM_LEN;
+static uint32_t rng_refills;
+static bool rng_seeded = false;
+static rng_health_test_t rng_health_test = NULL;
+
+/* === Private Functions =================================================== */
+
+/*
+ * trng32() - Read one word from the hardware RNG
+ *
+ * INPUT
+ *     none
+ * OUTPUT
+ *     32 bits from the hardware RNG, never equal to the previous word
+ */
+static uint32_t trng32(void)
 {
     uint32_t rng_samples = 0, rng_sr_img;
     static uint32_t last = 0, new = 0;
@@ -60,6 +93,172 @@ uint32_t random32(void)
     return new;
 }
 
+#define ROTL32(v, n)    (((v) << (n)) | ((v) >> (32 - (n))))
+#define QUARTERROUND(a, b, c, d) \
+    a += b; d ^= a; d = ROTL32(d, 16); \
+    c += d; b ^= c; b = ROTL32(b, 12); \
+    a += b; d ^= a; d = ROTL32(d, 8); \
+    c += d; b ^= c; b = ROTL32(b, 7)
+
+/*
+ * chacha20_block() - One ChaCha20 block of keystream with a zero nonce
+ *
+ * INPUT
+ *     - key: 256-bit key
+ *     - counter: block counter
+ *     - out: 64 bytes of keystream
+ * OUTPUT
+ *     none
+ */
+static void chacha20_block(const uint32_t key[8], uint32_t counter, uint8_t *out)
+{
+    uint32_t in[16], x[16];
+    int i;
+
+    in[0] = 0x61707865;
+    in[1] = 0x3320646e;
+    in[2] = 0x79622d32;
+    in[3] = 0x6b206574;
+    for (i = 0; i < 8; i++) {
+        in[4 + i] = key[i];
+    }
+    in[12] = counter;
+    in[13] = in[14] = in[15] = 0;
+
+    memcpy(x, in, sizeof(x));
+    for (i = 0; i < 10; i++) {
+        QUARTERROUND(x[0], x[4], x[8],  x[12]);
+        QUARTERROUND(x[1], x[5], x[9],  x[13]);
+        QUARTERROUND(x[2], x[6], x[10], x[14]);
+        QUARTERROUND(x[3], x[7], x[11], x[15]);
+        QUARTERROUND(x[0], x[5], x[10], x[15]);
+        QUARTERROUND(x[1], x[6], x[11], x[12]);
+        QUARTERROUND(x[2], x[7], x[8],  x[13]);
+        QUARTERROUND(x[3], x[4], x[9],  x[14]);
+    }
+
+    for (i = 0; i < 16; i++) {
+        x[i] += in[i];
+        out[4 * i]     = x[i];
+        out[4 * i + 1] = x[i] >> 8;
+        out[4 * i + 2] = x[i] >> 16;
+        out[4 * i + 3] = x[i] >> 24;
+    }
+
+    memset(in, 0, sizeof(in));
+    memset(x, 0, sizeof(x));
+}
+
+/*
+ * rng_reseed() - Mix fresh hardware RNG output into the key
+ *
+ * INPUT
+ *     none
+ * OUTPUT
+ *     none
+ *
+ * Halts the system if the health test keeps rejecting the hardware RNG.
+ */
+static void rng_reseed(void)
+{
+    uint32_t seed[8];
+    int i, tries;
+
+    for (tries = 0; ; tries++) {
+        for (i = 0; i < 8; i++) {
+            seed[i] = trng32();
+        }
+        if (rng_health_test == NULL || rng_health_test(seed, 8)) {
+            break;
+        }
+        if (tries + 1 >= RNG_HEALTH_RETRIES) {
+            /* The hardware RNG looks broken.  Fail closed */
+            memset(seed, 0, sizeof(seed));
+            system_halt();
+        }
+        /* Health test failed.  Restart the RNG and sample again */
+        reset_rng();
+    }
+
+    for (i = 0; i < 8; i++) {
+        rng_key[i] ^= seed[i];
+    }
+    rng_seeded = true;
+    memset(seed, 0, sizeof(seed));
+}
+
+/*
+ * rng_refill() - Generate the next part of the keystream and rekey
+ *
+ * INPUT
+ *     none
+ * OUTPUT
+ *     none
+ */
+static void rng_refill(void)
+{
+    int i;
+
+    if (!rng_seeded || ++rng_refills >= RNG_RESEED_REFILLS) {
+        rng_reseed();
+        rng_refills = 0;
+    }
+
+    for (i = 0; i < RNG_STREAM_BLOCKS; i++) {
+        chacha20_block(rng_key, rng_counter++, rng_stream + 64 * i);
+    }
+
+    /* Take the next key from the stream and erase it there */
+    for (i = 0; i < 8; i++) {
+        rng_key[i] = (uint32_t)rng_stream[4 * i] | ((uint32_t)rng_stream[4 * i + 1] << 8) |
+                     ((uint32_t)rng_stream[4 * i + 2] << 16) | ((uint32_t)rng_stream[4 * i + 3] << 24);
+    }
+    memset(rng_stream, 0, RNG_KEY_LEN);
+    rng_pos = RNG_KEY_LEN;
+}
+
+/* === Functions =========================================================== */
+
+/*
+ * rng_set_health_test() - Install a health test for the hardware RNG
+ *
+ * The test sees every batch of hardware RNG words before it is mixed into
+ * the generator, and returns false to reject it.  Rejected batches are
+ * discarded, the RNG is reset and sampled again.  After RNG_HEALTH_RETRIES
+ * rejected batches in a row the system halts.
+ *
+ * INPUT
+ *     - test: health test, or NULL to only use the built-in repetition test
+ * OUTPUT
+ *     none
+ */
+void rng_set_health_test(rng_health_test_t test)
+{
+    rng_health_test = test;
+}
+
+/*
+ * rng_reseed_now() - Force fresh hardware entropy into the next output
+ *
+ * INPUT
+ *     none
+ * OUTPUT
+ *     none
+ */
+void rng_reseed_now(void)
+{
+    memset(rng_stream, 0, sizeof(rng_stream));
+    rng_pos = RNG_STREAM_LEN;
+    rng_seeded = false;
+}
+
+uint32_t random32(void)
+{
+    uint32_t r;
+    random_buffer((uint8_t *)&r, sizeof(r));
+    return r;
+}
+
 uint32_t random_uniform(uint32_t n)
 {
     uint32_t x, max = 0xFFFFFFFF - (0xFFFFFFFF % n);
@@ -69,13 +268,21 @@ uint32_t random_uniform(uint32_t n)
 
 void random_buffer(uint8_t *buf, size_t len)
 {
-	size_t i;
-	uint32_t r = 0;
-	for (i = 0; i < len; i++) {
-		if (i % 4 == 0) {
-			r = random32();
+	size_t n;
+	while (len > 0) {
+		if (rng_pos == RNG_STREAM_LEN) {
+			rng_refill();
 		}
-		buf[i] = (r >> ((i % 4) * 8)) & 0xFF;
+		n = RNG_STREAM_LEN - rng_pos;
+		if (n > len) {
+			n = len;
+		}
+		memcpy(buf, rng_stream + rng_pos, n);
+		/* Served bytes are erased so they cannot be recovered later */
+		memset(rng_stream + rng_pos, 0, n);
+		rng_pos += n;
+		buf += n;
+		len -= n;
 	}
 }
 
@@ -89,4 +296,4 @@ void random_permute(char *str, size_t len)
         str[j] = str[i];
         str[i] = t;
     }
-}
\ No newline at end of file
+}
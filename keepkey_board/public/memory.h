@@ -204,6 +204,7 @@ static const FlashSector flash_sector_map[] =
 /* === Functions =========================================================== */
 
 void memory_protect(void);
+bool memory_bootloader_hash_step(void);
 int memory_bootloader_hash(uint8_t *hash);
 int memory_firmware_hash(uint8_t *hash);
 int memory_storage_hash(uint8_t *hash, Allocation storage_location);
@@ -22,11 +22,19 @@
 
 /* === Includes ============================================================ */
 
+#include <stdbool.h>
 #include <stdint.h>
 #include <stdlib.h>
 
+/* === Typedefs ============================================================ */
+
+/* Returns false if a batch of hardware RNG words looks broken */
+typedef bool (*rng_health_test_t)(const uint32_t *samples, size_t len);
+
 /* === Functions =========================================================== */
 
+void rng_set_health_test(rng_health_test_t test);
+void rng_reseed_now(void);
 uint32_t random32(void);
 uint32_t random_uniform(uint32_t n);
 void random_buffer(uint8_t *buf, size_t len);